@@ -2,14 +2,20 @@
 #define CILKSTL_ALGORITHM_H
 
 #include <cilk/cilk.h>
-#include <cilk/reducer.h>
-#include <cilk/reducer_max.h>
-#include <cilk/reducer_min.h>
-#include <cilk/reducer_opadd.h>
 
+#include "cilk_memory.h"
+#include "cilk_reduce.h"
+#include "cilk_simd.h"
+
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <functional>
 #include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace cilkstl {
 namespace __parallel {
@@ -36,22 +42,36 @@ _RandomAccessIterator rotate(_RandomAccessIterator first, _RandomAccessIterator
   // Rotates smaller segment into proper position
   // Loads larger segment from buffer and rotates into proper position
   if (a <= c / 2) {
-    value_t *buffer = new value_t[b];
+    TemporaryBuffer<value_t> temp(b);
+    value_t *buffer = temp.data();
     cilk_for(diff_t k = 0; k < b; ++k) { *(buffer + k) = std::move(*(middle + k)); }
     cilk_for(diff_t k = 0; k < a; ++k) { *(first + b + k) = std::move(*(first + k)); }
     cilk_for(diff_t k = 0; k < b; ++k) { *(first + k) = std::move(*(buffer + k)); }
-    delete[] buffer;
   } else {
-    value_t *buffer = new value_t[a];
+    TemporaryBuffer<value_t> temp(a);
+    value_t *buffer = temp.data();
     cilk_for(diff_t k = 0; k < a; ++k) { *(buffer + k) = std::move(*(first + k)); }
     cilk_for(diff_t k = 0; k < b; ++k) { *(first + k) = std::move(*(middle + k)); }
     cilk_for(diff_t k = 0; k < a; ++k) { *(first + b + k) = std::move(*(buffer + k)); }
-    delete[] buffer;
   }
 
   return first + b;
 }
 
+/**
+ * Implements spec from std::reverse by swapping the elements of the two halves of [first, last) in a cilk_for loop.
+ */
+template <class _RandomAccessIterator> void reverse(_RandomAccessIterator first, _RandomAccessIterator last) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+
+  cilk_for(diff_t k = 0; k < (last - first) / 2; ++k) {
+    value_t tmp = std::move(*(first + k));
+    *(first + k) = std::move(*(last - k - 1));
+    *(last - k - 1) = std::move(tmp);
+  }
+}
+
 /**
  * Rotate implementation using no additional memory. Reverses ranges [first, middle) and [middle, last). Then reverses
  * the whole array [first, last).
@@ -62,22 +82,10 @@ _RandomAccessIterator rotate_inplace(_RandomAccessIterator first, _RandomAccessI
   if (first >= last)
     return first;
 
-  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
-
-  // Defines a function that parallel reverses range [start, end) inplace
-  auto _reverse_inplace = [&](_RandomAccessIterator start, _RandomAccessIterator end) {
-    cilk_for(diff_t k = 0; k < (end - start) / 2; ++k) {
-      value_t tmp = std::move(*(start + k));
-      *(start + k) = std::move(*(end - k - 1));
-      *(end - k - 1) = std::move(tmp);
-    }
-  };
-
-  cilk_spawn _reverse_inplace(first, middle);
-  _reverse_inplace(middle, last);
+  cilk_spawn cilkstl::__parallel::reverse(first, middle);
+  cilkstl::__parallel::reverse(middle, last);
   cilk_sync;
-  _reverse_inplace(first, last);
+  cilkstl::__parallel::reverse(first, last);
 
   return first + (last - middle);
 }
@@ -99,26 +107,37 @@ _RandomAccessIterator2 transform(_RandomAccessIterator1 first, _RandomAccessIter
 }
 
 /**
- * Implements spec from std::max_element by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Defines whether min_element and max_element with `_Compare` can run on the SIMD kernels: the range must be contiguous
+ * storage of float, double or a signed 32 or 64-bit integer, and `_Compare` must be std::less
  */
-template <class _RandomAccessIterator>
-_RandomAccessIterator max_element(_RandomAccessIterator first, _RandomAccessIterator last) {
-  if (first >= last)
-    return first;
-
-  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+template <class _RandomAccessIterator, class _Compare> struct simd_extremum_applies {
   typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  static constexpr bool value =
+      is_contiguous_iterator<_RandomAccessIterator>::value && simd_extremum_type<value_t>::value &&
+      (std::is_same<_Compare, std::less<value_t>>::value || std::is_same<_Compare, std::less<>>::value);
+};
 
-  cilk::reducer<cilk::op_max_index<diff_t, value_t>> max_rd;
-  diff_t range_width = last - first;
-  cilk_for(diff_t diff = 0; diff < range_width; ++diff) { max_rd->calc_max(diff, *(first + diff)); }
-  return first + (max_rd.get_value().first);
+/**
+ * Helper method: returns the index of the first largest element of the nonempty index range [start, end) if `_Max` is
+ * true, or of the first smallest one otherwise
+ */
+template <bool _Max, class _RandomAccessIterator, class _DiffType, class _Compare>
+_DiffType extremum_block(_RandomAccessIterator first, _DiffType start, _DiffType end, _Compare &comp,
+                         std::false_type) {
+  _RandomAccessIterator result =
+      _Max ? std::max_element(first + start, first + end, comp) : std::min_element(first + start, first + end, comp);
+  return result - first;
+}
+
+template <bool _Max, class _RandomAccessIterator, class _DiffType, class _Compare>
+_DiffType extremum_block(_RandomAccessIterator first, _DiffType start, _DiffType end, _Compare &, std::true_type) {
+  return start + (_DiffType)simd_arg_extremum<_Max>(&*first + start, (std::size_t)(end - start));
 }
 
 /**
- * Implements spec from std::max_element by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Implements spec from std::max_element by finding the first largest element of every block serially and combining the
+ * block results pairwise, keeping the earlier of equal elements. Contiguous ranges of arithmetic types compared with
+ * std::less are searched with the SIMD kernels.
  */
 template <class _RandomAccessIterator, class _Compare>
 _RandomAccessIterator max_element(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp) {
@@ -126,86 +145,187 @@ _RandomAccessIterator max_element(_RandomAccessIterator first, _RandomAccessIter
     return first;
 
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef std::integral_constant<bool, simd_extremum_applies<_RandomAccessIterator, _Compare>::value> use_simd;
 
-  cilk::reducer<cilk::op_max_index<diff_t, value_t, _Compare>> max_rd(comp);
-  diff_t range_width = last - first;
-  cilk_for(diff_t diff = 0; diff < range_width; ++diff) { max_rd->calc_max(diff, *(first + diff)); }
-  return first + (max_rd.get_value().first);
+  auto block = [first, &comp](diff_t start, diff_t end) {
+    return cilkstl::__parallel::extremum_block<true>(first, start, end, comp, use_simd());
+  };
+  auto combine = [first, &comp](diff_t left, diff_t right) { return comp(first[left], first[right]) ? right : left; };
+  return first + cilkstl::__parallel::__reduce_range<diff_t>((diff_t)0, (diff_t)(last - first), block, combine);
 }
 
 /**
- * Implements spec from std::min_element by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Implements spec from std::max_element with operator<
  */
 template <class _RandomAccessIterator>
-_RandomAccessIterator min_element(_RandomAccessIterator first, _RandomAccessIterator last) {
+_RandomAccessIterator max_element(_RandomAccessIterator first, _RandomAccessIterator last) {
+  return cilkstl::__parallel::max_element(first, last, std::less<>());
+}
+
+/**
+ * Implements spec from std::min_element by finding the first smallest element of every block serially and combining
+ * the block results pairwise, keeping the earlier of equal elements. Contiguous ranges of arithmetic types compared
+ * with std::less are searched with the SIMD kernels.
+ */
+template <class _RandomAccessIterator, class _Compare>
+_RandomAccessIterator min_element(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp) {
   if (first >= last)
     return first;
 
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef std::integral_constant<bool, simd_extremum_applies<_RandomAccessIterator, _Compare>::value> use_simd;
 
-  cilk::reducer<cilk::op_min_index<diff_t, value_t>> min_rd;
-  diff_t range_width = last - first;
-  cilk_for(diff_t diff = 0; diff < range_width; ++diff) { min_rd->calc_min(diff, *(first + diff)); }
-  return first + (min_rd.get_value().first);
+  auto block = [first, &comp](diff_t start, diff_t end) {
+    return cilkstl::__parallel::extremum_block<false>(first, start, end, comp, use_simd());
+  };
+  auto combine = [first, &comp](diff_t left, diff_t right) { return comp(first[right], first[left]) ? right : left; };
+  return first + cilkstl::__parallel::__reduce_range<diff_t>((diff_t)0, (diff_t)(last - first), block, combine);
+}
+
+/**
+ * Implements spec from std::min_element with operator<
+ */
+template <class _RandomAccessIterator>
+_RandomAccessIterator min_element(_RandomAccessIterator first, _RandomAccessIterator last) {
+  return cilkstl::__parallel::min_element(first, last, std::less<>());
 }
 
 /**
- * Implements spec from std::min_element by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Implements spec from std::minmax_element in one pass: every block runs std::minmax_element, which compares elements
+ * in pairs for about 1.5 comparisons per element, and the block results are combined pairwise, keeping the first of
+ * equal smallest elements and the last of equal largest elements.
  */
 template <class _RandomAccessIterator, class _Compare>
-_RandomAccessIterator min_element(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp) {
+std::pair<_RandomAccessIterator, _RandomAccessIterator> minmax_element(_RandomAccessIterator first,
+                                                                       _RandomAccessIterator last, _Compare comp) {
   if (first >= last)
-    return first;
+    return std::make_pair(first, first);
 
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef std::pair<diff_t, diff_t> indices_t;
 
-  cilk::reducer<cilk::op_min_index<diff_t, value_t, _Compare>> min_rd(comp);
-  diff_t range_width = last - first;
-  cilk_for(diff_t diff = 0; diff < range_width; ++diff) { min_rd->calc_min(diff, *(first + diff)); }
-  return first + (min_rd.get_value().first);
+  auto block = [first, &comp](diff_t start, diff_t end) {
+    auto result = std::minmax_element(first + start, first + end, comp);
+    return indices_t(result.first - first, result.second - first);
+  };
+  auto combine = [first, &comp](indices_t left, indices_t right) {
+    return indices_t(comp(first[right.first], first[left.first]) ? right.first : left.first,
+                     comp(first[right.second], first[left.second]) ? left.second : right.second);
+  };
+  indices_t result = cilkstl::__parallel::__reduce_range<indices_t>((diff_t)0, (diff_t)(last - first), block, combine);
+  return std::make_pair(first + result.first, first + result.second);
 }
 
 /**
- * Implements spec from std::count by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Implements spec from std::minmax_element with operator<
  */
-template <class _RandomAccessIterator, class _Type>
+template <class _RandomAccessIterator>
+std::pair<_RandomAccessIterator, _RandomAccessIterator> minmax_element(_RandomAccessIterator first,
+                                                                       _RandomAccessIterator last) {
+  return cilkstl::__parallel::minmax_element(first, last, std::less<>());
+}
+
+/**
+ * Helper method for count_if that counts every block into a local variable and sums the block counts
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
 typename std::iterator_traits<_RandomAccessIterator>::difference_type
-count(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &value) {
+__count_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc &predicate, std::false_type) {
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  diff_t range_width = last - first;
-  cilk::reducer<cilk::op_add<diff_t>> count_rd;
-
-  cilk_for(diff_t k = 0; k < range_width; ++k) {
-    if (*(first + k) == value)
-      *count_rd += 1;
-  }
+  auto block = [first, &predicate](diff_t start, diff_t end) {
+    diff_t count = 0;
+    for (diff_t k = start; k < end; ++k)
+      count += predicate(first[k]) ? 1 : 0;
+    return count;
+  };
+  auto combine = std::plus<diff_t>();
+  return cilkstl::__parallel::__reduce_range<diff_t>((diff_t)0, (diff_t)(last - first), block, combine);
+}
 
-  return count_rd.get_value();
+template <class _RandomAccessIterator, class _PredicateFunc>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type
+__count_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc &predicate, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  auto block = [first, &predicate](diff_t start, diff_t end) {
+    return (diff_t)simd_count_if(&*first + start, (std::size_t)(end - start), predicate);
+  };
+  auto combine = std::plus<diff_t>();
+  return cilkstl::__parallel::__reduce_range<diff_t>((diff_t)0, (diff_t)(last - first), block, combine,
+                                                     (diff_t)REDUCE_SIMD_GRAIN);
 }
 
 /**
- * Implements spec from std::count_if by iterating through the array in a cilk_for loop and tracking the result with
- * a cilk reducer.
+ * Implements spec from std::count_if by counting every block into a local variable and summing the block counts.
+ * Contiguous ranges of arithmetic types are counted with the SIMD kernels when `predicate` is a threshold predicate
+ * such as less_than(x).
  */
 template <class _RandomAccessIterator, class _PredicateFunc>
 typename std::iterator_traits<_RandomAccessIterator>::difference_type
 count_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc predicate) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef std::integral_constant<bool, is_contiguous_iterator<_RandomAccessIterator>::value &&
+                                           simd_predicate<value_t, _PredicateFunc>::value>
+      use_simd;
+  if (first >= last)
+    return 0;
+  return cilkstl::__parallel::__count_if(first, last, predicate, use_simd());
+}
+
+/**
+ * Defines whether count with a value of type `_Type` can run on the equality counting kernels: the range must be
+ * contiguous storage of an arithmetic type they handle, and `_Type` must be an integer if the elements are, or the
+ * element type otherwise
+ */
+template <class _RandomAccessIterator, class _Type> struct simd_count_applies {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  static constexpr bool value =
+      is_contiguous_iterator<_RandomAccessIterator>::value && simd_count_type<value_t>::value &&
+      (std::is_same<value_t, _Type>::value ||
+       (std::is_integral<value_t>::value && std::is_integral<_Type>::value && !std::is_same<_Type, bool>::value));
+};
+
+/**
+ * Helper method for count with a value that is compared element by element
+ */
+template <class _RandomAccessIterator, class _Type>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type
+__count(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &value, std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::reference ref_t;
+  return cilkstl::__parallel::count_if(first, last, [&value](ref_t x) { return x == value; });
+}
+
+/**
+ * Helper method for count on the equality counting kernels. An integer value that does not survive conversion to the
+ * element type equals no element.
+ */
+template <class _RandomAccessIterator, class _Type>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type
+__count(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &value, std::true_type) {
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  diff_t range_width = last - first;
-  cilk::reducer<cilk::op_add<diff_t>> count_rd;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  value_t needle = static_cast<value_t>(value);
+  if (!(needle == value))
+    return 0;
 
-  cilk_for(diff_t k = 0; k < range_width; ++k) {
-    if (predicate(*(first + k)))
-      *count_rd += 1;
-  }
+  auto block = [first, needle](diff_t start, diff_t end) {
+    return (diff_t)simd_count_equal(&*first + start, (std::size_t)(end - start), needle);
+  };
+  auto combine = std::plus<diff_t>();
+  return cilkstl::__parallel::__reduce_range<diff_t>((diff_t)0, (diff_t)(last - first), block, combine,
+                                                     (diff_t)REDUCE_SIMD_GRAIN);
+}
 
-  return count_rd.get_value();
+/**
+ * Implements spec from std::count by counting every block into a local variable and summing the block counts.
+ * Contiguous ranges of arithmetic types, down to bytes, are counted with the SIMD kernels.
+ */
+template <class _RandomAccessIterator, class _Type>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type
+count(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &value) {
+  typedef std::integral_constant<bool, simd_count_applies<_RandomAccessIterator, _Type>::value> use_simd;
+  if (first >= last)
+    return 0;
+  return cilkstl::__parallel::__count(first, last, value, use_simd());
 }
 
 // Grain size that determines cutoff to switch to serial code for parallel code that splits the range in half and
@@ -213,38 +333,54 @@ count_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc
 constexpr int BINARY_GRAIN_SIZE = 2000;
 
 /**
- * Implements spec from std::is_sorted by splitting the array in half and recursively solving each half in parallel.
+ * Helper function for is_sorted that contains the logic to split the problem into halves and recurse in parallel,
+ * clearing the atomic flag `sorted` when a violation is found. Each recursive call is prefaced by a check to the flag so
+ * that the remaining work is cancelled as soon as the first violation is seen.
  */
 template <class _RandomAccessIterator, class _Compare>
-bool is_sorted(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp) {
+void __is_sorted(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp, std::atomic<bool> &sorted) {
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
   diff_t range_width = last - first;
-  if (range_width < 2)
-    return true;
+  if (!sorted.load(std::memory_order_relaxed))
+    return;
 
   // default to serial code if problem size is too small
-  _RandomAccessIterator second_last = last - 1;
   if (range_width < BINARY_GRAIN_SIZE) {
-    for (auto it = first; it < second_last; ++it) {
-      if (comp(*(it + 1), *it))
-        return false;
+    for (auto it = first; it + 1 < last; ++it) {
+      if (comp(*(it + 1), *it)) {
+        sorted.store(false, std::memory_order_relaxed);
+        return;
+      }
     }
-    return true;
+    return;
   }
 
   _RandomAccessIterator middle = first + (range_width / 2);
 
   // handle edge case where middle - 1 is in left spawn but middle is in right spawn
-  if (comp(*middle, *(middle - 1)))
-    return false;
+  if (comp(*middle, *(middle - 1))) {
+    sorted.store(false, std::memory_order_relaxed);
+    return;
+  }
 
   // recursively spawn left and right halves
-  bool first_sorted = cilk_spawn is_sorted(first, middle, comp);
-  bool second_sorted = is_sorted(middle, last, comp);
+  cilk_spawn cilkstl::__parallel::__is_sorted(first, middle, comp, sorted);
+  cilkstl::__parallel::__is_sorted(middle, last, comp, sorted);
   cilk_sync;
+}
 
-  // return result
-  return (first_sorted && second_sorted);
+/**
+ * Implements spec from std::is_sorted by splitting the array in half and recursively solving each half in parallel,
+ * cancelling outstanding work once a violation is found.
+ */
+template <class _RandomAccessIterator, class _Compare>
+bool is_sorted(_RandomAccessIterator first, _RandomAccessIterator last, _Compare comp) {
+  if (last - first < 2)
+    return true;
+
+  std::atomic<bool> sorted(true);
+  ::cilkstl::__parallel::__is_sorted(first, last, comp, sorted);
+  return sorted.load();
 }
 
 /**
@@ -275,40 +411,49 @@ _RandomAccessIterator find(_RandomAccessIterator first, _RandomAccessIterator la
 constexpr int FIND2_GRAIN_SIZE = 2400;
 
 /**
- * Helper function for find2 that contains the logic to split the problem into halves and recurse in parallel, assigning
- * the result to an atomic variable. Each recursive call is prefaced by a check to the atomic variable to avoid
- * unnecessary work if a better index has already been found.
+ * Helper function for find2 and adjacent_find that contains the logic to split the index range [start, end) into halves
+ * and recurse in parallel, assigning the lowest index returned by `leaf` to an atomic variable. `leaf(start, end)` must
+ * return the lowest matching index in [start, end), or `end` if there is none. Each recursive call is prefaced by a
+ * check to the atomic variable to avoid unnecessary work if a better index has already been found.
  */
-template <class _RandomAccessIterator, class T>
-void __find2(_RandomAccessIterator begin, typename std::iterator_traits<_RandomAccessIterator>::difference_type start,
-             typename std::iterator_traits<_RandomAccessIterator>::difference_type end, const T &value,
-             std::atomic<typename std::iterator_traits<_RandomAccessIterator>::difference_type> &idx) {
-  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  diff_t range_width = end - start;
+template <class _DiffType, class _LeafFunc>
+void __find_first(_DiffType start, _DiffType end, _LeafFunc leaf, std::atomic<_DiffType> &idx) {
+  _DiffType range_width = end - start;
 
   // Only do work if range represented by this recursive call includes values less than
   // the current lowest found index
   if (start < idx) {
     if (range_width < FIND2_GRAIN_SIZE) {
-      // for small arrays, run find in serial and update the atomic variable `idx` containing the result as needed
-      _RandomAccessIterator result = std::find(begin + start, begin + end, value);
-      diff_t r = result - begin;
+      // for small arrays, run the leaf in serial and update the atomic variable `idx` containing the result as needed
+      _DiffType r = leaf(start, end);
       if (r < end) {
-        for (diff_t z = idx; r < z; z = idx) {
+        for (_DiffType z = idx; r < z; z = idx) {
           idx.compare_exchange_weak(z, r);
         }
       }
     } else {
       // recurse into two array halves
-      diff_t middle = start + range_width / 2;
-      cilk_spawn cilkstl::__parallel::__find2(begin, start, middle, value, idx);
-      cilkstl::__parallel::__find2(begin, middle, end, value, idx);
+      _DiffType middle = start + range_width / 2;
+      cilk_spawn cilkstl::__parallel::__find_first(start, middle, leaf, idx);
+      cilkstl::__parallel::__find_first(middle, end, leaf, idx);
     }
   }
 
   return;
 }
 
+/**
+ * Helper function for find2 that searches [start, end) of the array beginning at `begin` for `value`
+ */
+template <class _RandomAccessIterator, class T>
+void __find2(_RandomAccessIterator begin, typename std::iterator_traits<_RandomAccessIterator>::difference_type start,
+             typename std::iterator_traits<_RandomAccessIterator>::difference_type end, const T &value,
+             std::atomic<typename std::iterator_traits<_RandomAccessIterator>::difference_type> &idx) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  cilkstl::__parallel::__find_first(
+      start, end, [begin, &value](diff_t s, diff_t e) { return std::find(begin + s, begin + e, value) - begin; }, idx);
+}
+
 /**
  * Implements spec from std::find by splitting the array in half and recursively solving each half in parallel, using
  *  an atomic variable to keep track of the result.
@@ -326,6 +471,88 @@ _RandomAccessIterator find2(_RandomAccessIterator first, _RandomAccessIterator l
   return first + idx;
 }
 
+/**
+ * Implements spec from std::adjacent_find with the binary predicate `pred`, using the same cancellable recursion as
+ * find2: a leaf covering indices [start, end) checks the pairs that begin there, reading one element past its end.
+ */
+template <class _RandomAccessIterator, class _BinaryPredicate>
+_RandomAccessIterator adjacent_find(_RandomAccessIterator first, _RandomAccessIterator last, _BinaryPredicate pred) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (range_width <= 2 * FIND2_GRAIN_SIZE) {
+    return std::adjacent_find(first, last, pred);
+  }
+
+  // Pairs begin at indices [0, range_width - 1); stores the lowest one found, or range_width
+  std::atomic<diff_t> idx(range_width);
+  cilkstl::__parallel::__find_first(
+      (diff_t)0, range_width - 1,
+      [first, &pred](diff_t s, diff_t e) {
+        diff_t r = std::adjacent_find(first + s, first + (e + 1), pred) - first;
+        return r == e + 1 ? e : r;
+      },
+      idx);
+  return first + idx;
+}
+
+/**
+ * Implements spec from std::adjacent_find with operator==
+ */
+template <class _RandomAccessIterator>
+_RandomAccessIterator adjacent_find(_RandomAccessIterator first, _RandomAccessIterator last) {
+  return cilkstl::__parallel::adjacent_find(first, last, std::equal_to<>());
+}
+
+// Grain size for parallel adjacent_difference function
+constexpr int ADJACENT_DIFFERENCE_GRAIN_SIZE = 16384;
+
+/**
+ * Implements spec from std::adjacent_difference with the binary operation `op` by computing fixed size blocks in a
+ * cilk_for loop. The element before each block is saved before any block is written, so the output iterator may equal
+ * `first`; it must support random access.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _BinaryOperation>
+_OutputIterator adjacent_difference(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                                    _BinaryOperation op) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  if (range_width < 2 * ADJACENT_DIFFERENCE_GRAIN_SIZE) {
+    return std::adjacent_difference(first, last, d_first, op);
+  }
+
+  diff_t num_blocks = (range_width + ADJACENT_DIFFERENCE_GRAIN_SIZE - 1) / ADJACENT_DIFFERENCE_GRAIN_SIZE;
+  std::vector<value_t> boundaries; // boundaries[b] is the element before block b + 1
+  boundaries.reserve(num_blocks - 1);
+  for (diff_t b = 1; b < num_blocks; ++b)
+    boundaries.push_back(first[b * ADJACENT_DIFFERENCE_GRAIN_SIZE - 1]);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t begin = b * ADJACENT_DIFFERENCE_GRAIN_SIZE;
+    diff_t end = std::min(range_width, begin + ADJACENT_DIFFERENCE_GRAIN_SIZE);
+    value_t previous = b == 0 ? value_t(first[0]) : std::move(boundaries[b - 1]);
+    if (b == 0) {
+      d_first[0] = previous;
+      ++begin;
+    }
+    for (diff_t i = begin; i < end; ++i) {
+      value_t current = first[i];
+      d_first[i] = op(current, std::move(previous));
+      previous = std::move(current);
+    }
+  }
+  return d_first + range_width;
+}
+
+/**
+ * Implements spec from std::adjacent_difference with operator-
+ */
+template <class _RandomAccessIterator, class _OutputIterator>
+_OutputIterator adjacent_difference(_RandomAccessIterator first, _RandomAccessIterator last,
+                                    _OutputIterator d_first) {
+  return cilkstl::__parallel::adjacent_difference(first, last, d_first, std::minus<>());
+}
+
 } // namespace __parallel
 }; // namespace cilkstl
 
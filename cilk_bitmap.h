@@ -0,0 +1,428 @@
+#ifndef CILKSTL_BITMAP_H
+#define CILKSTL_BITMAP_H
+
+#include <cilk/cilk.h>
+
+#include "cilk_algorithm.h"
+#include "cilk_memory.h"
+#include "cilk_reduce.h"
+#include "cilk_simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cilkstl {
+namespace __parallel {
+
+constexpr std::size_t BITMAP_BLOCK_WORDS = 128;                   // words per block of work and of the rank index
+constexpr std::size_t BITMAP_BLOCK_BITS = 64 * BITMAP_BLOCK_WORDS; // elements covered by one block
+
+/**
+ * This file implements selection bitmaps, which record the result of a predicate over a range with one bit per
+ * element. The predicate is evaluated once, in parallel, and the bitmap can then drive counting and any number of
+ * filters or partitions of the same range.
+ */
+
+/**
+ * Helper method: returns the position of the set bit of `word` with rank `k`, counting from the least significant bit.
+ * Assumes `word` has more than `k` set bits.
+ */
+inline unsigned select_in_word(std::uint64_t word, unsigned k) {
+  for (; k > 0; --k)
+    word &= word - 1;
+  return (unsigned)__builtin_ctzll(word);
+}
+
+/**
+ * Defines a packed bitmap over `size` elements in which bit `i` records whether element `i` of a range is selected.
+ * Bits are stored in 64-bit words, and the words are grouped into blocks of BITMAP_BLOCK_WORDS that are processed by
+ * one task each. A rank index holding the number of selected elements before every block supports count, rank and
+ * select; it is built by select_bitmap, and must be rebuilt with build_rank_index after modifying the words directly.
+ */
+class SelectionBitmap {
+public:
+  SelectionBitmap(std::size_t size)
+      : size_(size), words_((size + 63) / 64, 0),
+        block_offsets_((size + BITMAP_BLOCK_BITS - 1) / BITMAP_BLOCK_BITS + 1, 0) {}
+
+  std::size_t size() const { return size_; }
+  std::size_t num_words() const { return words_.size(); }
+  std::size_t num_blocks() const { return block_offsets_.size() - 1; }
+  std::uint64_t *words() { return words_.data(); }
+  const std::uint64_t *words() const { return words_.data(); }
+
+  bool test(std::size_t i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+
+  /**
+   * Returns the number of selected elements before block `b`, or the total for `b` equal to num_blocks()
+   */
+  std::size_t block_offset(std::size_t b) const { return block_offsets_[b]; }
+
+  /**
+   * Rebuilds the rank index by counting the set bits of every block in parallel with simd_popcount
+   */
+  void build_rank_index() {
+    std::size_t blocks = num_blocks();
+    cilk_for(std::size_t b = 0; b < blocks; ++b) {
+      std::size_t begin = b * BITMAP_BLOCK_WORDS;
+      std::size_t end = std::min(words_.size(), begin + BITMAP_BLOCK_WORDS);
+      block_offsets_[b] = simd_popcount(words_.data() + begin, end - begin);
+    }
+
+    std::size_t sum = 0;
+    for (std::size_t b = 0; b <= blocks; ++b) {
+      std::size_t count = (b < blocks) ? block_offsets_[b] : 0;
+      block_offsets_[b] = sum;
+      sum += count;
+    }
+  }
+
+  /**
+   * Returns the number of selected elements
+   */
+  std::size_t count() const { return block_offsets_.back(); }
+
+  /**
+   * Returns the number of selected elements before position `i`, for `i` in [0, size()]
+   */
+  std::size_t rank(std::size_t i) const {
+    std::size_t b = i / BITMAP_BLOCK_BITS;
+    std::size_t result = block_offsets_[b];
+    std::size_t w = b * BITMAP_BLOCK_WORDS;
+    result += simd_popcount(words_.data() + w, i / 64 - w);
+    if (i % 64 != 0)
+      result += __builtin_popcountll(words_[i / 64] & ((std::uint64_t(1) << (i % 64)) - 1));
+    return result;
+  }
+
+  /**
+   * Returns the position of the selected element with rank `k`, for `k` in [0, count()). The block is found by binary
+   * search over the rank index and the word by scanning the block.
+   */
+  std::size_t select(std::size_t k) const {
+    std::size_t b = std::upper_bound(block_offsets_.begin(), block_offsets_.end(), k) - block_offsets_.begin() - 1;
+    k -= block_offsets_[b];
+    for (std::size_t w = b * BITMAP_BLOCK_WORDS;; ++w) {
+      std::size_t bits = __builtin_popcountll(words_[w]);
+      if (k < bits)
+        return w * 64 + select_in_word(words_[w], (unsigned)k);
+      k -= bits;
+    }
+  }
+
+  /**
+   * Calls `f(i)` for every selected position `i` in block `b`, in increasing order
+   */
+  template <class _Func> void for_each_in_block(std::size_t b, _Func f) const {
+    std::size_t end = std::min(words_.size(), (b + 1) * BITMAP_BLOCK_WORDS);
+    for (std::size_t w = b * BITMAP_BLOCK_WORDS; w < end; ++w) {
+      for (std::uint64_t word = words_[w]; word != 0; word &= word - 1)
+        f(w * 64 + __builtin_ctzll(word));
+    }
+  }
+
+  /**
+   * Returns the positions of all selected elements in increasing order, selecting them block by block in parallel
+   */
+  std::vector<std::size_t> positions() const {
+    std::vector<std::size_t> result(count());
+    cilk_for(std::size_t b = 0; b < num_blocks(); ++b) {
+      std::size_t *out = result.data() + block_offsets_[b];
+      for_each_in_block(b, [&](std::size_t i) { *out++ = i; });
+    }
+    return result;
+  }
+
+private:
+  std::size_t size_;
+  std::vector<std::uint64_t> words_;
+  std::vector<std::size_t> block_offsets_;
+};
+
+/**
+ * Helper method for select_bitmap on contiguous arithmetic input with a threshold predicate, which evaluates every
+ * block with the SIMD kernels
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+void __select_bitmap(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                     SelectionBitmap &selection, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  std::size_t range_width = last - first;
+  const value_t *in = &*first;
+  cilk_for(std::size_t b = 0; b < selection.num_blocks(); ++b) {
+    std::size_t begin = b * BITMAP_BLOCK_BITS;
+    std::size_t end = std::min(range_width, begin + BITMAP_BLOCK_BITS);
+    simd_predicate_bits(in + begin, end - begin, selection.words() + b * BITMAP_BLOCK_WORDS, p);
+  }
+}
+
+/**
+ * Helper method for select_bitmap in the general case, which evaluates `p` element by element and packs the results of
+ * every 64 elements into one word
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+void __select_bitmap(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                     SelectionBitmap &selection, std::false_type) {
+  std::size_t range_width = last - first;
+  std::uint64_t *words = selection.words();
+  cilk_for(std::size_t b = 0; b < selection.num_blocks(); ++b) {
+    std::size_t end = std::min(selection.num_words(), (b + 1) * BITMAP_BLOCK_WORDS);
+    for (std::size_t w = b * BITMAP_BLOCK_WORDS; w < end; ++w) {
+      std::uint64_t word = 0;
+      for (std::size_t j = 0; j < 64 && w * 64 + j < range_width; ++j)
+        word |= (std::uint64_t)(bool)p(*(first + (w * 64 + j))) << j;
+      words[w] = word;
+    }
+  }
+}
+
+/**
+ * Evaluates the predicate `p` on every element of [first, last) exactly once, in parallel, and returns the results as
+ * a SelectionBitmap with its rank index built. Contiguous arithmetic input with a ThresholdPredicate is evaluated with
+ * the SIMD kernels, which write whole words of comparison masks at a time.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+SelectionBitmap select_bitmap(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef std::integral_constant<bool, is_contiguous_iterator<_RandomAccessIterator>::value &&
+                                           simd_predicate<value_t, _PredicateFunc>::value>
+      use_simd;
+  SelectionBitmap selection(last - first);
+  __select_bitmap(first, last, p, selection, use_simd());
+  selection.build_rank_index();
+  return selection;
+}
+
+/**
+ * Implements spec from std::count_if for a predicate already evaluated into `selection`, which is simply its count
+ */
+template <class _RandomAccessIterator>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type
+count_if(_RandomAccessIterator first, _RandomAccessIterator last, const SelectionBitmap &selection) {
+  (void)first;
+  (void)last;
+  return (typename std::iterator_traits<_RandomAccessIterator>::difference_type)selection.count();
+}
+
+/**
+ * Implements spec from std::copy_if for a predicate already evaluated into `selection`. Every block of the bitmap
+ * copies its selected elements in parallel, starting at the destination given by the rank index, so no counting pass
+ * is needed. The output iterator must support random access.
+ */
+template <class _RandomAccessIterator, class _OutputIterator>
+_OutputIterator copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                        const SelectionBitmap &selection) {
+  (void)last;
+  cilk_for(std::size_t b = 0; b < selection.num_blocks(); ++b) {
+    _OutputIterator out = d_first + selection.block_offset(b);
+    selection.for_each_in_block(b, [&](std::size_t i) { *out++ = *(first + i); });
+  }
+  return d_first + selection.count();
+}
+
+/**
+ * Helper method: distributes the elements of [first, last) over two output ranges in parallel, one bitmap block per
+ * task, as scatter_blocks does for flags. Selected elements are transferred to the range beginning at `out_true` and
+ * the rest to the range beginning at `out_false`, both in their original relative order.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _TransferFunc>
+void scatter_selection(_RandomAccessIterator first, _RandomAccessIterator last, const SelectionBitmap &selection,
+                       _OutputIterator1 out_true, _OutputIterator2 out_false, _TransferFunc transfer) {
+  std::size_t range_width = last - first;
+  cilk_for(std::size_t b = 0; b < selection.num_blocks(); ++b) {
+    std::size_t begin = b * BITMAP_BLOCK_BITS;
+    std::size_t end = std::min(range_width, begin + BITMAP_BLOCK_BITS);
+    _OutputIterator1 t = out_true + selection.block_offset(b);
+    _OutputIterator2 f = out_false + (begin - selection.block_offset(b));
+    for (std::size_t i = begin; i < end; ++i) {
+      if (selection.test(i))
+        transfer(t++, *(first + i));
+      else
+        transfer(f++, *(first + i));
+    }
+  }
+}
+
+/**
+ * Implements spec from std::partition_copy for a predicate already evaluated into `selection`, copying the selected
+ * elements to the range beginning at `d_true` and the rest to the range beginning at `d_false`. The output iterators
+ * must support random access.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2>
+std::pair<_OutputIterator1, _OutputIterator2> partition_copy(_RandomAccessIterator first, _RandomAccessIterator last,
+                                                             _OutputIterator1 d_true, _OutputIterator2 d_false,
+                                                             const SelectionBitmap &selection) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  std::size_t num_true = selection.count();
+  auto copy_to = [](auto dest, const value_t &src) { *dest = src; };
+  scatter_selection(first, last, selection, d_true, d_false, copy_to);
+  return std::make_pair(d_true + num_true, d_false + ((last - first) - num_true));
+}
+
+/**
+ * Implements spec from std::stable_partition for a predicate already evaluated into `selection`. The blocks scatter
+ * their elements into uninitialized scratch storage in parallel at the destinations given by the rank index, and the
+ * elements are moved back.
+ */
+template <class _RandomAccessIterator>
+_RandomAccessIterator stable_partition(_RandomAccessIterator first, _RandomAccessIterator last,
+                                       const SelectionBitmap &selection) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  diff_t num_true = selection.count();
+
+  UninitializedBuffer<value_t> buffer(range_width);
+  value_t *out = buffer.data();
+  auto construct = [](value_t *dest, value_t &src) { new (dest) value_t(std::move(src)); };
+  scatter_selection(first, last, selection, out, out + num_true, construct);
+  cilk_for(diff_t k = 0; k < range_width; ++k) {
+    *(first + k) = std::move(*(out + k));
+    (out + k)->~value_t();
+  }
+
+  return first + num_true;
+}
+
+/**
+ * Defines a read-only view of `size` bits stored in 64-bit words, starting at bit `offset` of the first word, with bits
+ * numbered from the least significant bit of each word. It lets the word-level count and find below run over a
+ * SelectionBitmap, a std::vector<bool> or any other packed bit array.
+ */
+class BitsetView {
+public:
+  BitsetView(const std::uint64_t *words, std::size_t offset, std::size_t size)
+      : words_(words + offset / 64), offset_(offset % 64), size_(size) {}
+  BitsetView(const SelectionBitmap &selection) : BitsetView(selection.words(), 0, selection.size()) {}
+
+  std::size_t size() const { return size_; }
+  std::size_t offset() const { return offset_; }
+  std::size_t num_words() const { return size_ == 0 ? 0 : (offset_ + size_ + 63) / 64; }
+  const std::uint64_t *words() const { return words_; }
+
+  bool test(std::size_t i) const { return (words_[(offset_ + i) / 64] >> ((offset_ + i) % 64)) & 1; }
+
+  /**
+   * Returns word `w` of the view with the bits before the first bit and after the last bit cleared, inverted first if
+   * `value` is false so that the set bits are those equal to `value`
+   */
+  std::uint64_t word(std::size_t w, bool value) const {
+    std::uint64_t bits = value ? words_[w] : ~words_[w];
+    if (w == 0)
+      bits &= ~std::uint64_t(0) << offset_;
+    std::size_t end = (offset_ + size_) % 64;
+    if (w + 1 == num_words() && end != 0)
+      bits &= (std::uint64_t(1) << end) - 1;
+    return bits;
+  }
+
+private:
+  const std::uint64_t *words_;
+  std::size_t offset_;
+  std::size_t size_;
+};
+
+/**
+ * Returns the number of bits of `bits` equal to `value`. Words are counted in parallel blocks with simd_popcount; only
+ * the first and last words need masking.
+ */
+inline std::size_t count(const BitsetView &bits, bool value) {
+  std::size_t num_words = bits.num_words();
+  if (num_words == 0)
+    return 0;
+
+  auto block = [&bits, num_words](std::size_t start, std::size_t end) {
+    std::size_t inner_begin = std::max(start, (std::size_t)1);
+    std::size_t inner_end = std::min(end, num_words - 1);
+    std::size_t ones = inner_begin < inner_end ? simd_popcount(bits.words() + inner_begin, inner_end - inner_begin) : 0;
+    if (start == 0)
+      ones += __builtin_popcountll(bits.word(0, true));
+    if (end == num_words && num_words > 1)
+      ones += __builtin_popcountll(bits.word(num_words - 1, true));
+    return ones;
+  };
+  auto combine = std::plus<std::size_t>();
+  std::size_t ones = cilkstl::__parallel::__reduce_range<std::size_t>((std::size_t)0, num_words, block, combine);
+  return value ? ones : bits.size() - ones;
+}
+
+/**
+ * Returns the position of the first bit of `bits` equal to `value`, or bits.size() if there is none. Words are searched
+ * with the cancellable recursion of find2, and the first matching word is resolved with count-trailing-zeros.
+ */
+inline std::size_t find(const BitsetView &bits, bool value) {
+  typedef std::ptrdiff_t diff_t;
+  diff_t num_words = (diff_t)bits.num_words();
+  auto leaf = [&bits, value](diff_t start, diff_t end) {
+    for (diff_t w = start; w < end; ++w) {
+      if (bits.word(w, value) != 0)
+        return w;
+    }
+    return end;
+  };
+  std::atomic<diff_t> idx(num_words);
+  if (num_words > 0)
+    cilkstl::__parallel::__find_first((diff_t)0, num_words, leaf, idx);
+  diff_t w = idx;
+  if (w == num_words)
+    return bits.size();
+  return (std::size_t)w * 64 + __builtin_ctzll(bits.word(w, value)) - bits.offset();
+}
+
+#if defined(__GLIBCXX__) && __SIZEOF_LONG__ == 8
+
+/**
+ * Helper method: returns a view of the bits of the std::vector<bool> range [first, last), read through the word pointer
+ * and bit offset of the libstdc++ bit iterators
+ */
+inline BitsetView bit_range_view(std::_Bit_const_iterator first, std::_Bit_const_iterator last) {
+  return BitsetView(reinterpret_cast<const std::uint64_t *>(first._M_p), first._M_offset, (std::size_t)(last - first));
+}
+
+/**
+ * Implements spec from std::count on std::vector<bool> with the word-level count on a BitsetView instead of reading
+ * the elements one proxy reference at a time. A value that is neither false nor true equals no element.
+ */
+template <class _Type>
+std::ptrdiff_t count(std::_Bit_const_iterator first, std::_Bit_const_iterator last, const _Type &value) {
+  bool target = static_cast<bool>(value);
+  if (first >= last || !(target == value))
+    return 0;
+  return (std::ptrdiff_t)cilkstl::__parallel::count(bit_range_view(first, last), target);
+}
+
+template <class _Type> std::ptrdiff_t count(std::_Bit_iterator first, std::_Bit_iterator last, const _Type &value) {
+  return cilkstl::__parallel::count(std::_Bit_const_iterator(first), std::_Bit_const_iterator(last), value);
+}
+
+/**
+ * Implements spec from std::find on std::vector<bool> with the word-level find on a BitsetView. A value that is
+ * neither false nor true equals no element.
+ */
+template <class _Type>
+std::_Bit_const_iterator find(std::_Bit_const_iterator first, std::_Bit_const_iterator last, const _Type &value) {
+  bool target = static_cast<bool>(value);
+  if (first >= last || !(target == value))
+    return last;
+  return first + (std::ptrdiff_t)cilkstl::__parallel::find(bit_range_view(first, last), target);
+}
+
+template <class _Type>
+std::_Bit_iterator find(std::_Bit_iterator first, std::_Bit_iterator last, const _Type &value) {
+  std::_Bit_const_iterator const_first(first);
+  return first + (cilkstl::__parallel::find(const_first, std::_Bit_const_iterator(last), value) - const_first);
+}
+
+#endif // __GLIBCXX__
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef CILKSTL_COUNTING_SORT_H
+#define CILKSTL_COUNTING_SORT_H
+
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+
+#include "cilk_partition.h"
+#include "cilk_stable_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cilkstl {
+namespace __parallel {
+namespace __sort {
+
+constexpr int COUNTING_SORT_GRAIN = 8192;          // minimum number of elements per block in key_minmax
+constexpr int COUNTING_SORT_BLOCKS_PER_WORKER = 4; // blocks per cilk worker in key_minmax
+constexpr int COUNTING_SORT_MAX_RANGE = 1 << 16;   // largest key range for which counting sort is considered
+constexpr int COUNTING_SORT_RANGE_RATIO = 4;       // counting sort requires the key range to be at most n / ratio
+
+/**
+ * This file implements a parallel stable counting sort for sequences whose keys are integers drawn from a small domain.
+ * Keys are obtained through a key extractor so that records can be sorted by one of their fields.
+ */
+
+/**
+ * Defines the key type produced by applying `_KeyFunc` to an element of `_RandomAccessIterator`
+ */
+template <class _RandomAccessIterator, class _KeyFunc> struct key_type {
+  typedef typename std::decay<decltype(std::declval<_KeyFunc &>()(*std::declval<_RandomAccessIterator &>()))>::type
+      type;
+};
+
+/**
+ * Helper method that returns the number of blocks the range of length `range_width` is split into by key_minmax.
+ */
+template <class _DiffType> _DiffType key_minmax_blocks(_DiffType range_width) {
+  _DiffType max_blocks = (_DiffType)(COUNTING_SORT_BLOCKS_PER_WORKER * __cilkrts_get_nworkers());
+  return std::max((_DiffType)1, std::min(range_width / COUNTING_SORT_GRAIN, max_blocks));
+}
+
+/**
+ * Helper method that returns true if counting sort should be used on a range of length `range_width` whose largest and
+ * smallest keys differ by `key_span`.
+ */
+template <class _DiffType> bool counting_sort_applies(std::uintmax_t key_span, _DiffType range_width) {
+  return key_span < (std::uintmax_t)COUNTING_SORT_MAX_RANGE &&
+         key_span < (std::uintmax_t)(range_width / COUNTING_SORT_RANGE_RATIO);
+}
+
+/**
+ * Helper method that computes the smallest and largest key in [first, last) in a single parallel pass. Each block
+ * computes its own minimum and maximum serially and the block results are combined at the end. Assumes the range is
+ * not empty.
+ */
+template <class _RandomAccessIterator, class _KeyFunc>
+std::pair<typename key_type<_RandomAccessIterator, _KeyFunc>::type,
+          typename key_type<_RandomAccessIterator, _KeyFunc>::type>
+key_minmax(_RandomAccessIterator first, _RandomAccessIterator last, _KeyFunc key) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename key_type<_RandomAccessIterator, _KeyFunc>::type key_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = key_minmax_blocks(range_width);
+  diff_t block_size = (range_width + num_blocks - 1) / num_blocks;
+
+  std::vector<key_t> mins(num_blocks);
+  std::vector<key_t> maxs(num_blocks);
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    _RandomAccessIterator s = first + b * block_size;
+    _RandomAccessIterator e = first + std::min(range_width, (b + 1) * block_size);
+    key_t lo = key(*s);
+    key_t hi = lo;
+    for (++s; s < e; ++s) {
+      key_t k = key(*s);
+      if (k < lo)
+        lo = k;
+      if (hi < k)
+        hi = k;
+    }
+    mins[b] = lo;
+    maxs[b] = hi;
+  }
+
+  return std::make_pair(*std::min_element(mins.begin(), mins.end()), *std::max_element(maxs.begin(), maxs.end()));
+}
+
+/**
+ * Helper method that stably sorts [first, last) by key, given that every key lies in [key_min, key_min + key_range).
+ * This is a k-way partition_by with one bucket per key: every block builds its own histogram in parallel, a prefix over
+ * the histograms in key-major order assigns each (block, key) pair its destination, and the blocks scatter their
+ * elements in order in parallel, so equal keys retain their relative order.
+ */
+template <class _RandomAccessIterator, class _KeyFunc>
+void counting_sort(_RandomAccessIterator first, _RandomAccessIterator last, _KeyFunc key,
+                   typename key_type<_RandomAccessIterator, _KeyFunc>::type key_min, std::size_t key_range) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  auto bucket_of = [&](const value_t &v) { return (diff_t)((std::uintmax_t)key(v) - (std::uintmax_t)key_min); };
+  cilkstl::__parallel::partition_by(first, last, bucket_of, (diff_t)key_range);
+}
+
+/**
+ * Stably sorts [first, last) by the integral or enumeration key returned by `key` using a parallel counting sort. The
+ * key range is computed with a parallel pass; when it is too large for counting sort (including spans that cover the
+ * whole key type) the range is sorted with stable_sort instead.
+ */
+template <class _RandomAccessIterator, class _KeyFunc>
+void counting_sort(_RandomAccessIterator first, _RandomAccessIterator last, _KeyFunc key) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef typename key_type<_RandomAccessIterator, _KeyFunc>::type key_t;
+  static_assert(std::is_integral<key_t>::value || std::is_enum<key_t>::value,
+                "counting_sort requires integral or enumeration keys");
+  diff_t range_width = last - first;
+  if (range_width < 2)
+    return;
+
+  std::pair<key_t, key_t> bounds = key_minmax(first, last, key);
+  std::uintmax_t key_span = (std::uintmax_t)bounds.second - (std::uintmax_t)bounds.first;
+  if (counting_sort_applies(key_span, range_width)) {
+    counting_sort(first, last, key, bounds.first, (std::size_t)key_span + 1);
+    return;
+  }
+
+  auto key_comp = [&](const value_t &lhs, const value_t &rhs) { return key(lhs) < key(rhs); };
+  cilkstl::__parallel::__sort::stable_sort(first, last, key_comp);
+}
+
+/**
+ * Stably sorts [first, last) in ascending order of the integral or enumeration key returned by `key`. A parallel
+ * min/max pass over the keys decides the algorithm: counting sort is used when the key range is small relative to the
+ * length of the range, and the parallel merge sort in stable_sort is used otherwise.
+ */
+template <class _RandomAccessIterator, class _KeyFunc>
+void stable_sort_by_key(_RandomAccessIterator first, _RandomAccessIterator last, _KeyFunc key) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  typedef typename key_type<_RandomAccessIterator, _KeyFunc>::type key_t;
+  static_assert(std::is_integral<key_t>::value || std::is_enum<key_t>::value,
+                "stable_sort_by_key requires integral or enumeration keys");
+  diff_t range_width = last - first;
+  auto key_comp = [&](const value_t &lhs, const value_t &rhs) { return key(lhs) < key(rhs); };
+
+  // Defaults to serial implementation at small range sizes
+  if (range_width < CILKSTL_PARALLEL_CUTOFF) {
+    std::stable_sort(first, last, key_comp);
+    return;
+  }
+
+  std::pair<key_t, key_t> bounds = key_minmax(first, last, key);
+  std::uintmax_t key_span = (std::uintmax_t)bounds.second - (std::uintmax_t)bounds.first;
+  if (counting_sort_applies(key_span, range_width)) {
+    counting_sort(first, last, key, bounds.first, (std::size_t)key_span + 1);
+    return;
+  }
+
+  cilkstl::__parallel::__sort::stable_sort(first, last, key_comp);
+}
+
+} // namespace __sort
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
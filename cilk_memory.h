@@ -0,0 +1,249 @@
+#ifndef CILKSTL_MEMORY_H
+#define CILKSTL_MEMORY_H
+
+#include <cilk/cilk.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#ifdef CILKSTL_HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace cilkstl {
+namespace __parallel {
+
+constexpr std::size_t BUFFER_PAGE_SIZE = 4096;                 // granularity at which FIRST_TOUCH buffers are touched
+constexpr std::size_t HUGE_PAGE_SIZE = 2 << 20;                // size and alignment of transparent huge pages
+constexpr std::size_t HUGE_PAGE_THRESHOLD = 8 * HUGE_PAGE_SIZE; // smallest buffer backed by huge pages
+
+/**
+ * This file implements the temporary buffers used by the parallel algorithms, along with the policy that decides how
+ * their pages are placed on NUMA machines.
+ */
+
+/**
+ * Page placement policies for temporary buffers. PLAIN leaves placement to the allocator and the first writer.
+ * FIRST_TOUCH touches every page from a cilk_for when the buffer is allocated, so that pages are spread across the
+ * nodes of the workers instead of landing on the node of the allocating thread. The worker that touches a page is not
+ * necessarily the one that later uses it, so this balances memory traffic across nodes rather than making every access
+ * node-local. INTERLEAVED interleaves
+ * pages across all nodes with libnuma, which requires compiling with CILKSTL_HAVE_LIBNUMA and linking -lnuma, and
+ * behaves as FIRST_TOUCH otherwise.
+ */
+enum class BufferPlacement { PLAIN, FIRST_TOUCH, INTERLEAVED };
+
+/**
+ * Returns a reference to the placement policy used for temporary buffers, which defaults to FIRST_TOUCH
+ */
+inline BufferPlacement &buffer_placement() {
+  static BufferPlacement placement = BufferPlacement::FIRST_TOUCH;
+  return placement;
+}
+
+/**
+ * Sets the placement policy used for temporary buffers allocated after the call
+ */
+inline void set_buffer_placement(BufferPlacement placement) { buffer_placement() = placement; }
+
+/**
+ * Returns a reference to the flag that enables transparent huge page backing for buffers of at least
+ * HUGE_PAGE_THRESHOLD bytes. Enabled by default on platforms that support MADV_HUGEPAGE.
+ */
+inline bool &buffer_huge_pages() {
+  static bool huge_pages = true;
+  return huge_pages;
+}
+
+/**
+ * Enables or disables huge page backing for temporary buffers allocated after the call
+ */
+inline void set_buffer_huge_pages(bool enabled) { buffer_huge_pages() = enabled; }
+
+/**
+ * Helper method that returns true if a buffer of `bytes` bytes should be backed by transparent huge pages
+ */
+inline bool use_huge_pages(std::size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  return buffer_huge_pages() && bytes >= HUGE_PAGE_THRESHOLD;
+#else
+  (void)bytes;
+  return false;
+#endif
+}
+
+/**
+ * Helper method that returns true if the machine has more than one NUMA node. The result is computed once.
+ */
+inline bool numa_multi_node() {
+#ifdef CILKSTL_HAVE_LIBNUMA
+  static const bool multi_node = numa_available() >= 0 && numa_num_configured_nodes() > 1;
+#else
+  static const bool multi_node = access("/sys/devices/system/node/node1", F_OK) == 0;
+#endif
+  return multi_node;
+}
+
+/**
+ * Helper method that returns the placement actually applied to a new buffer. Single node machines always use PLAIN,
+ * and INTERLEAVED is only honored when libnuma is available.
+ */
+inline BufferPlacement effective_buffer_placement() {
+  BufferPlacement placement = buffer_placement();
+  if (!numa_multi_node())
+    return BufferPlacement::PLAIN;
+#ifndef CILKSTL_HAVE_LIBNUMA
+  if (placement == BufferPlacement::INTERLEAVED)
+    return BufferPlacement::FIRST_TOUCH;
+#endif
+  return placement;
+}
+
+/**
+ * Helper method that maps `bytes` bytes rounded up to a multiple of HUGE_PAGE_SIZE at a HUGE_PAGE_SIZE aligned address
+ * and advises the kernel to back the mapping with transparent huge pages. The mapping is over-allocated by one huge
+ * page and the unaligned head and tail are unmapped again. Returns nullptr if the mapping fails, for example when the
+ * process has reached its limit on the number of mappings.
+ */
+inline void *map_huge_buffer(std::size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  std::size_t length = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  void *mapped = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED)
+    return nullptr;
+
+  char *base = static_cast<char *>(mapped);
+  char *aligned = base + (HUGE_PAGE_SIZE - (std::size_t)base % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+  if (aligned > base)
+    munmap(base, aligned - base);
+  if (aligned < base + HUGE_PAGE_SIZE)
+    munmap(aligned + length, base + HUGE_PAGE_SIZE - aligned);
+  madvise(aligned, length, MADV_HUGEPAGE);
+  return aligned;
+#else
+  (void)bytes;
+  return nullptr;
+#endif
+}
+
+/**
+ * Helper method that allocates `bytes` bytes of uninitialized memory placed according to `placement`, backed by huge
+ * pages if `huge_pages` is set. If the huge page mapping fails, `huge_pages` is cleared and the memory is allocated as
+ * if it had not been requested.
+ */
+inline void *allocate_buffer(std::size_t bytes, BufferPlacement placement, bool &huge_pages) {
+  void *data = huge_pages ? map_huge_buffer(bytes) : nullptr;
+  if (data != nullptr) {
+#ifdef CILKSTL_HAVE_LIBNUMA
+    if (placement == BufferPlacement::INTERLEAVED)
+      numa_interleave_memory(data, bytes, numa_all_nodes_ptr);
+#endif
+  } else {
+    huge_pages = false;
+#ifdef CILKSTL_HAVE_LIBNUMA
+    if (placement == BufferPlacement::INTERLEAVED) {
+      data = numa_alloc_interleaved(bytes);
+      if (data == nullptr)
+        throw std::bad_alloc();
+      return data;
+    }
+#endif
+    data = std::malloc(bytes == 0 ? 1 : bytes);
+    if (data == nullptr)
+      throw std::bad_alloc();
+  }
+
+  // Touches one byte per page in parallel so that the pages are spread over the nodes of the workers
+  if (placement == BufferPlacement::FIRST_TOUCH) {
+    volatile char *pages = static_cast<volatile char *>(data);
+    std::size_t num_pages = (bytes + BUFFER_PAGE_SIZE - 1) / BUFFER_PAGE_SIZE;
+    cilk_for(std::size_t k = 0; k < num_pages; ++k) { pages[k * BUFFER_PAGE_SIZE] = 0; }
+  }
+  return data;
+}
+
+/**
+ * Helper method that releases memory obtained from allocate_buffer with the same `bytes` and `placement`, and the
+ * `huge_pages` flag as left by allocate_buffer
+ */
+inline void free_buffer(void *data, std::size_t bytes, BufferPlacement placement, bool huge_pages) {
+#ifdef MADV_HUGEPAGE
+  if (huge_pages) {
+    munmap(data, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+    return;
+  }
+#else
+  (void)huge_pages;
+#endif
+#ifdef CILKSTL_HAVE_LIBNUMA
+  if (placement == BufferPlacement::INTERLEAVED) {
+    numa_free(data, bytes);
+    return;
+  }
+#else
+  (void)bytes;
+  (void)placement;
+#endif
+  std::free(data);
+}
+
+/**
+ * Defines uninitialized storage for `size` elements for use as scratch space by the parallel algorithms. Its pages are
+ * placed according to the buffer placement policy, and large buffers are backed by huge pages when enabled. Elements
+ * constructed in the buffer must be destroyed by the caller before the buffer goes out of scope.
+ */
+template <class _DataType> class UninitializedBuffer {
+public:
+  UninitializedBuffer(std::size_t size)
+      : size_(size), placement_(effective_buffer_placement()), huge_pages_(use_huge_pages(size * sizeof(_DataType))) {
+    data_ = static_cast<_DataType *>(allocate_buffer(size_ * sizeof(_DataType), placement_, huge_pages_));
+  }
+
+  ~UninitializedBuffer() { free_buffer(data_, size_ * sizeof(_DataType), placement_, huge_pages_); }
+
+  _DataType *data() { return data_; }
+  std::size_t size() const { return size_; }
+
+private:
+  _DataType *data_;
+  std::size_t size_;
+  BufferPlacement placement_;
+  bool huge_pages_;
+
+  // disallow copies
+  UninitializedBuffer(const UninitializedBuffer &);
+  UninitializedBuffer &operator=(const UninitializedBuffer &);
+};
+
+/**
+ * Defines a buffer of `size` default constructed elements for use as scratch space by the parallel algorithms, placed
+ * like UninitializedBuffer. Trivial types are left uninitialized, as with new[].
+ */
+template <class _DataType> class TemporaryBuffer : public UninitializedBuffer<_DataType> {
+public:
+  TemporaryBuffer(std::size_t size) : UninitializedBuffer<_DataType>(size) {
+    if (!std::is_trivially_default_constructible<_DataType>::value) {
+      for (std::size_t k = 0; k < size; ++k)
+        new (this->data() + k) _DataType();
+    }
+  }
+
+  ~TemporaryBuffer() {
+    if (!std::is_trivially_destructible<_DataType>::value) {
+      for (std::size_t k = 0; k < this->size(); ++k)
+        (this->data() + k)->~_DataType();
+    }
+  }
+};
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
@@ -2,21 +2,80 @@
 #define CILKSTL_ALGORITHM_PARTITION_H
 
 #include <cilk/cilk.h>
-#include <cilk/reducer.h>
-#include <cilk/reducer_max.h>
-#include <cilk/reducer_min.h>
-#include <cilk/reducer_opadd.h>
+#include <cilk/cilk_api.h>
 
+#include "cilk_memory.h"
+#include "cilk_scan.h"
+#include "cilk_simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace cilkstl {
 namespace __parallel {
 
-constexpr int PARTITION_GS = 4096; // Below this grainsize partition will default to serial
-constexpr int PART_SIZE = 64;      // TODO make this a function of array length
+constexpr int PARTITION_GS = 4096;             // Below this grainsize partition will default to serial
+constexpr int PART_SIZE_PER_WORKER = 8;        // Number of strides per worker in partition
+constexpr int PARTITION_BLOCK_SIZE = 8192;     // Number of elements per block in the block-based partitions
+constexpr int PARTITION_CHUNKS_PER_WORKER = 4; // Number of contiguous chunks per worker in partition_blocked
+constexpr int CACHE_LINE_SIZE = 64;            // Chunk boundaries in partition_blocked are aligned to a cache line
+constexpr int BRANCHLESS_BLOCK_SIZE = 128;     // Number of elements scanned per offset block in branchless_partition
+
+/**
+ * Helper method: serial code to compute a partition inplace without branching on the predicate, in the style of
+ * BlockQuicksort. A block of BRANCHLESS_BLOCK_SIZE elements is scanned from each end of the unprocessed region, and the
+ * offsets of the misplaced elements (failing `p` on the left, satisfying `p` on the right) are recorded in small
+ * on-stack buffers by always writing the offset and advancing the count by the predicate result. The recorded elements
+ * are then swapped in bulk, and a block is refilled once all of its offsets are used. The final few blocks are handed
+ * to std::partition.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator branchless_partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  unsigned char offsets_l[BRANCHLESS_BLOCK_SIZE];
+  unsigned char offsets_r[BRANCHLESS_BLOCK_SIZE];
+  int num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+  // [first, last) is the unprocessed region; everything before it satisfies `p` and everything after it does not
+  while (last - first > 2 * BRANCHLESS_BLOCK_SIZE) {
+    if (num_l == 0) {
+      start_l = 0;
+      for (int i = 0; i < BRANCHLESS_BLOCK_SIZE; ++i) {
+        offsets_l[num_l] = (unsigned char)i;
+        num_l += !p(*(first + i));
+      }
+    }
+    if (num_r == 0) {
+      start_r = 0;
+      for (int i = 0; i < BRANCHLESS_BLOCK_SIZE; ++i) {
+        offsets_r[num_r] = (unsigned char)i;
+        num_r += !!p(*(last - 1 - i));
+      }
+    }
+
+    int num = std::min(num_l, num_r);
+    for (int j = 0; j < num; ++j)
+      std::iter_swap(first + offsets_l[start_l + j], last - 1 - offsets_r[start_r + j]);
+    num_l -= num;
+    num_r -= num;
+    start_l += num;
+    start_r += num;
+    if (num_l == 0)
+      first += BRANCHLESS_BLOCK_SIZE;
+    if (num_r == 0)
+      last -= BRANCHLESS_BLOCK_SIZE;
+  }
+
+  return std::partition(first, last, p);
+}
 
 /**
  * Helper method: serial code to compute a partition inplace using the predicate `p` amongst elements that are index
@@ -57,33 +116,1017 @@ strided_partition(_RandomAccessIterator first, _RandomAccessIterator last, _Pred
 }
 
 /**
- * Computes a parallel partition by splitting the input sequence into blocks of size `PART_SIZE` and
- * computing a partitioning amongst the ith element in each block in parallel. There's an uncertain
- * region in the middle, and this region is partitioned serially in the end. This algorithm works
- * best when the sizes of the two partitions are similar and the two classes are distributed
- * somewhat randomly. It can exhibit poor performance otherwise.
+ * Helper method: returns the number of strides used by partition on a sequence of length `range_width`. The count grows
+ * with the number of workers, but is limited so that every stride holds at least PARTITION_GS elements.
  */
+template <class _DiffType> _DiffType partition_strides(_DiffType range_width) {
+  _DiffType max_strides = (_DiffType)PART_SIZE_PER_WORKER * __cilkrts_get_nworkers();
+  return std::max((_DiffType)1, std::min(range_width / PARTITION_GS, max_strides));
+}
+
+// Defined below; used by partition_strided to resolve its uncertain region
 template <class _RandomAccessIterator, class _PredicateFunc>
-_RandomAccessIterator partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+_RandomAccessIterator partition_blocked(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p);
+
+/**
+ * Computes a parallel partition by splitting the input sequence into blocks of the size given by partition_strides and
+ * computing a partitioning amongst the ith element in each block in parallel. There's an uncertain region in the
+ * middle, which is partitioned in parallel with partition_blocked in the end. This algorithm works best when the sizes
+ * of the two partitions are similar and the two classes are distributed somewhat randomly, as the uncertain region is
+ * small then. Since every task touches every `strides`-th element, neighbouring tasks share cache lines; partition uses
+ * contiguous chunks instead and this version is retained for comparison.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator partition_strided(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
   diff_t range_width = last - first;
   if (range_width < PARTITION_GS) {
-    return std::partition(first, last, p);
+    return branchless_partition(first, last, p);
   }
 
-  diff_t num_parts = (diff_t)(range_width / PART_SIZE);
-  std::vector<diff_t> results(PART_SIZE);
+  diff_t strides = partition_strides(range_width);
+  diff_t num_parts = (diff_t)(range_width / strides);
+  std::vector<diff_t> results(strides);
 
-  // spawn the strided partitions in parallel for each stride in [0, PART_SIZE)
-  for (int i = 0; i < PART_SIZE; ++i) {
-    results[i] = cilk_spawn strided_partition(first, last, p, num_parts, i);
+  // spawn the strided partitions in parallel for each stride in [0, strides)
+  for (diff_t i = 0; i < strides; ++i) {
+    results[i] = cilk_spawn strided_partition(first, last, p, num_parts, (int)i);
   }
   cilk_sync;
 
   // partition the region between the smallest partition cutoff and the largest partition cutoff amongst the strides
   diff_t left = *std::min_element(results.begin(), results.end());
   diff_t right = *std::max_element(results.begin(), results.end());
-  return std::partition(first + left, first + right, p);
+  return partition_blocked(first + left, first + right, p);
+}
+
+/**
+ * Helper method: returns the number of blocks of PARTITION_BLOCK_SIZE elements needed to cover `range_width` elements.
+ */
+template <class _DiffType> _DiffType num_partition_blocks(_DiffType range_width) {
+  return (range_width + PARTITION_BLOCK_SIZE - 1) / PARTITION_BLOCK_SIZE;
+}
+
+/**
+ * Helper method: replaces the `num_blocks` block counts in `offsets` by their exclusive prefix sum, so that
+ * `offsets[b]` holds the sum of the counts before block `b` and `offsets[num_blocks]` holds the total. The prefix is
+ * computed with the two-level parallel exclusive_scan_inplace, so its span is O(num_blocks / p + p).
+ */
+template <class _DiffType> void block_offsets(_DiffType *offsets, _DiffType num_blocks) {
+  offsets[num_blocks] = 0;
+  cilkstl::__parallel::exclusive_scan_inplace(offsets, offsets + num_blocks + 1, (_DiffType)0);
+}
+
+/**
+ * Helper method: evaluates the predicate `p` on every element of [first, last) in parallel, one block of
+ * PARTITION_BLOCK_SIZE elements per task. The result for each element is stored in `flags`, and the number of elements
+ * in block `b` that satisfy `p` is stored in `offsets[b]`. Then `offsets` is replaced by its exclusive prefix sum, so
+ * that `offsets[b]` holds the number of satisfying elements before block `b` and `offsets[num_blocks]` holds the total.
+ * `offsets` must have room for num_partition_blocks(last - first) + 1 entries.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+void flag_blocks(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p, bool *flags,
+                 typename std::iterator_traits<_RandomAccessIterator>::difference_type *offsets) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = num_partition_blocks(range_width);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    diff_t count = 0;
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k) {
+      flags[k] = p(*(first + k));
+      count += flags[k];
+    }
+    offsets[b] = count;
+  }
+  block_offsets(offsets, num_blocks);
+}
+
+/**
+ * Helper method: the SIMD counterpart of flag_blocks for contiguous arithmetic input and a threshold predicate. Counts
+ * the elements of every block of [in, in + range_width) that satisfy `p` with simd_count_if in parallel, and turns the
+ * counts into offsets as flag_blocks does. No flags are stored, since split_blocks_simd evaluates `p` again.
+ */
+template <class _Type, class _PredicateFunc, class _DiffType>
+void count_blocks_simd(const _Type *in, _DiffType range_width, _PredicateFunc p, _DiffType *offsets) {
+  _DiffType num_blocks = num_partition_blocks(range_width);
+  cilk_for(_DiffType b = 0; b < num_blocks; ++b) {
+    _DiffType begin = b * PARTITION_BLOCK_SIZE;
+    _DiffType end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    offsets[b] = (_DiffType)simd_count_if(in + begin, (std::size_t)(end - begin), p);
+  }
+  block_offsets(offsets, num_blocks);
+}
+
+/**
+ * Helper method: distributes the elements of [first, last) over two output ranges in parallel, one block of
+ * PARTITION_BLOCK_SIZE elements per task. Elements whose flag is set are transferred to the range beginning at
+ * `out_true`, and the rest to the range beginning at `out_false`, both in their original relative order. `flags` and
+ * `offsets` are as computed by flag_blocks. Each element is written with `transfer(destination, source)`, which lets the
+ * caller choose between moving, copying and constructing into uninitialized memory.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _TransferFunc>
+void scatter_blocks(_RandomAccessIterator first, _RandomAccessIterator last, const bool *flags,
+                    const typename std::iterator_traits<_RandomAccessIterator>::difference_type *offsets,
+                    _OutputIterator1 out_true, _OutputIterator2 out_false, _TransferFunc transfer) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = num_partition_blocks(range_width);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    _OutputIterator1 t = out_true + offsets[b];
+    _OutputIterator2 f = out_false + (b * PARTITION_BLOCK_SIZE - offsets[b]);
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k) {
+      if (flags[k])
+        transfer(t++, *(first + k));
+      else
+        transfer(f++, *(first + k));
+    }
+  }
+}
+
+/**
+ * Helper method: the SIMD counterpart of scatter_blocks for contiguous arithmetic input and a threshold predicate.
+ * Every block is split between `out_true` and `out_false` with simd_split in parallel, at the destinations given by
+ * `offsets` as computed by count_blocks_simd.
+ */
+template <class _Type, class _PredicateFunc, class _DiffType>
+void split_blocks_simd(const _Type *in, _DiffType range_width, const _DiffType *offsets, _Type *out_true,
+                       _Type *out_false, _PredicateFunc p) {
+  _DiffType num_blocks = num_partition_blocks(range_width);
+  cilk_for(_DiffType b = 0; b < num_blocks; ++b) {
+    _DiffType begin = b * PARTITION_BLOCK_SIZE;
+    _DiffType end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    simd_split(in + begin, (std::size_t)(end - begin), out_true + offsets[b], out_false + (begin - offsets[b]), p);
+  }
+}
+
+/**
+ * Defines whether stable_partition and partition_copy can use the SIMD kernels on [first, last) of
+ * `_RandomAccessIterator` with predicate `_PredicateFunc`, which requires contiguous storage of a type and predicate
+ * accepted by simd_predicate.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc> struct simd_partition_applies {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  static constexpr bool value =
+      is_contiguous_iterator<_RandomAccessIterator>::value && simd_predicate<value_t, _PredicateFunc>::value;
+};
+
+/**
+ * Helper method for stable_partition on contiguous arithmetic input with a threshold predicate. The blocks are counted
+ * and split with the SIMD kernels, which compress the lanes of each class into consecutive positions of the scratch
+ * storage, and the result is copied back.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator __stable_partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                                         std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  value_t *in = &*first;
+
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  count_blocks_simd(in, range_width, p, offsets.data());
+  diff_t num_true = offsets.back();
+
+  UninitializedBuffer<value_t> buffer(range_width);
+  value_t *out = buffer.data();
+  split_blocks_simd(in, range_width, offsets.data(), out, out + num_true, p);
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    std::copy(out + begin, out + end, in + begin);
+  }
+
+  return first + num_true;
+}
+
+/**
+ * Helper method for stable_partition in the general case. Each block flags and counts its elements satisfying `p` in
+ * parallel, a prefix over the block counts assigns every block its destinations, and the blocks scatter their elements
+ * in order into uninitialized scratch storage in parallel, from which they are moved back.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator __stable_partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                                         std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+
+  TemporaryBuffer<bool> flags(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  flag_blocks(first, last, p, flags.data(), offsets.data());
+  diff_t num_true = offsets.back();
+
+  UninitializedBuffer<value_t> buffer(range_width);
+  value_t *out = buffer.data();
+  auto construct = [](value_t *dest, value_t &src) { new (dest) value_t(std::move(src)); };
+  scatter_blocks(first, last, flags.data(), offsets.data(), out, out + num_true, construct);
+  cilk_for(diff_t k = 0; k < range_width; ++k) {
+    *(first + k) = std::move(*(out + k));
+    (out + k)->~value_t();
+  }
+
+  return first + num_true;
+}
+
+/**
+ * Implements spec from std::stable_partition with a span that does not depend on how the two classes are distributed.
+ * The sequence is split into blocks of PARTITION_BLOCK_SIZE elements, each block counts its elements satisfying `p` in
+ * parallel, a prefix over the block counts assigns every block its destinations, and the blocks scatter their elements
+ * in order into uninitialized scratch storage in parallel, from which they are moved back. Contiguous ranges of float,
+ * double or signed 32 and 64 bit integers partitioned by a ThresholdPredicate such as less_than(x) are counted and
+ * scattered with the SIMD compress kernels instead.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator stable_partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (range_width < PARTITION_GS) {
+    return std::stable_partition(first, last, p);
+  }
+  typedef std::integral_constant<bool, simd_partition_applies<_RandomAccessIterator, _PredicateFunc>::value> use_simd;
+  return __stable_partition(first, last, p, use_simd());
+}
+
+/**
+ * Helper method: splits every block of PARTITION_BLOCK_SIZE elements of [first, last) into the same block of the
+ * uninitialized storage `chunks` in parallel. The elements satisfying `p` are written to the front of the block in
+ * order and the rest to its back in reverse order, each with `transfer(destination, source)`, and the number of
+ * satisfying elements in each block is turned into offsets as flag_blocks does. `chunks` must have room for
+ * last - first elements. Every element is read and `p` is evaluated exactly once.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc, class _TransferFunc>
+void split_chunks(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                  typename std::iterator_traits<_RandomAccessIterator>::value_type *chunks,
+                  typename std::iterator_traits<_RandomAccessIterator>::difference_type *offsets,
+                  _TransferFunc transfer) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = num_partition_blocks(range_width);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    value_t *t = chunks + b * PARTITION_BLOCK_SIZE;
+    value_t *f = chunks + end;
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k) {
+      if (p(*(first + k)))
+        transfer(t++, *(first + k));
+      else
+        transfer(--f, *(first + k));
+    }
+    offsets[b] = t - (chunks + b * PARTITION_BLOCK_SIZE);
+  }
+  block_offsets(offsets, num_blocks);
+}
+
+/**
+ * Helper method: moves the blocks split by split_chunks to the ranges beginning at `out_true` and `out_false` in
+ * parallel, restoring the original order of the elements at the back of each block, and destroys them in `chunks`.
+ */
+template <class _Type, class _DiffType, class _OutputIterator1, class _OutputIterator2>
+void concatenate_split_chunks(_Type *chunks, _DiffType range_width, const _DiffType *offsets, _OutputIterator1 out_true,
+                              _OutputIterator2 out_false) {
+  cilk_for(_DiffType b = 0; b < num_partition_blocks(range_width); ++b) {
+    _DiffType begin = b * PARTITION_BLOCK_SIZE;
+    _DiffType end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    _DiffType middle = begin + (offsets[b + 1] - offsets[b]);
+    _OutputIterator1 t = out_true + offsets[b];
+    for (_DiffType k = begin; k < middle; ++k, ++t) {
+      *t = std::move(chunks[k]);
+      chunks[k].~_Type();
+    }
+    _OutputIterator2 f = out_false + (begin - offsets[b]);
+    for (_DiffType k = end; k > middle; ++f) {
+      --k;
+      *f = std::move(chunks[k]);
+      chunks[k].~_Type();
+    }
+  }
+}
+
+/**
+ * Computes a parallel partition whose span does not depend on how the two classes are distributed. The sequence is
+ * split into blocks of PARTITION_BLOCK_SIZE elements, and every block moves its elements into its own chunk of scratch
+ * storage in parallel, those satisfying `p` to the front of the chunk and the rest to its back. A prefix over the block
+ * counts then places the chunks, which are moved back into [first, last) in parallel. Unlike stable_partition, no
+ * per-element flags are stored and every element is read from the input only once. The relative order of the elements
+ * is preserved.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator partition_buffered(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  if (range_width < PARTITION_GS) {
+    return std::partition(first, last, p);
+  }
+
+  UninitializedBuffer<value_t> chunks(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  auto construct = [](value_t *dest, value_t &src) { new (dest) value_t(std::move(src)); };
+  split_chunks(first, last, p, chunks.data(), offsets.data(), construct);
+  diff_t num_true = offsets.back();
+  concatenate_split_chunks(chunks.data(), range_width, offsets.data(), first, first + num_true);
+
+  return first + num_true;
+}
+
+/**
+ * Helper method for partition_copy into contiguous output ranges of the input type, on contiguous arithmetic input with
+ * a threshold predicate. Every block is split with the SIMD kernels into its own chunks of scratch storage for either
+ * class, reading the input once, and the chunks are copied into the output ranges in parallel.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _PredicateFunc>
+std::pair<_OutputIterator1, _OutputIterator2> __partition_copy(_RandomAccessIterator first, _RandomAccessIterator last,
+                                                               _OutputIterator1 d_true, _OutputIterator2 d_false,
+                                                               _PredicateFunc p, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  const value_t *in = &*first;
+
+  UninitializedBuffer<value_t> chunks(2 * range_width);
+  value_t *chunk_true = chunks.data();
+  value_t *chunk_false = chunks.data() + range_width;
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    offsets[b] = (diff_t)simd_split(in + begin, (std::size_t)(end - begin), chunk_true + begin, chunk_false + begin, p);
+  }
+  block_offsets(offsets.data(), num_partition_blocks(range_width));
+  diff_t num_true = offsets.back();
+
+  // An output range receiving no elements may be an end iterator, which must not be dereferenced
+  value_t *out_true = (num_true > 0) ? &*d_true : nullptr;
+  value_t *out_false = (num_true < range_width) ? &*d_false : nullptr;
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    diff_t block_true = offsets[b + 1] - offsets[b];
+    std::copy(chunk_true + begin, chunk_true + begin + block_true, out_true + offsets[b]);
+    std::copy(chunk_false + begin, chunk_false + end - block_true, out_false + (begin - offsets[b]));
+  }
+
+  return std::make_pair(d_true + num_true, d_false + (range_width - num_true));
+}
+
+/**
+ * Helper method for partition_copy in the general case. Every block splits its elements into its own chunk of scratch
+ * storage, reading the input once, and the chunks are moved into the output ranges in parallel.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _PredicateFunc>
+std::pair<_OutputIterator1, _OutputIterator2> __partition_copy(_RandomAccessIterator first, _RandomAccessIterator last,
+                                                               _OutputIterator1 d_true, _OutputIterator2 d_false,
+                                                               _PredicateFunc p, std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+
+  UninitializedBuffer<value_t> chunks(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  auto construct = [](value_t *dest, const value_t &src) { new (dest) value_t(src); };
+  split_chunks(first, last, p, chunks.data(), offsets.data(), construct);
+  diff_t num_true = offsets.back();
+  concatenate_split_chunks(chunks.data(), range_width, offsets.data(), d_true, d_false);
+
+  return std::make_pair(d_true + num_true, d_false + (range_width - num_true));
+}
+
+/**
+ * Defines whether partition_copy can use the SIMD kernels, which additionally requires both output ranges to be
+ * contiguous storage of the input type
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _PredicateFunc>
+struct simd_partition_copy_applies {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  static constexpr bool value =
+      simd_partition_applies<_RandomAccessIterator, _PredicateFunc>::value &&
+      is_contiguous_iterator<_OutputIterator1>::value && is_contiguous_iterator<_OutputIterator2>::value &&
+      std::is_same<value_t, typename std::iterator_traits<_OutputIterator1>::value_type>::value &&
+      std::is_same<value_t, typename std::iterator_traits<_OutputIterator2>::value_type>::value;
+};
+
+/**
+ * Implements spec from std::partition_copy by copying the elements satisfying `p` to the range beginning at `d_true`
+ * and the rest to the range beginning at `d_false`, preserving their relative order. The input is read in a single
+ * parallel pass over blocks of PARTITION_BLOCK_SIZE elements, each of which splits its elements into its own chunk of
+ * scratch storage; a prefix over the block counts then places the chunks, which are concatenated into the output
+ * ranges in parallel. The output iterators must support random access. Contiguous arithmetic input partitioned by a
+ * ThresholdPredicate into contiguous output is handled by the SIMD compress kernels.
+ */
+template <class _RandomAccessIterator, class _OutputIterator1, class _OutputIterator2, class _PredicateFunc>
+std::pair<_OutputIterator1, _OutputIterator2> partition_copy(_RandomAccessIterator first, _RandomAccessIterator last,
+                                                             _OutputIterator1 d_true, _OutputIterator2 d_false,
+                                                             _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (range_width < PARTITION_GS) {
+    return std::partition_copy(first, last, d_true, d_false, p);
+  }
+  typedef std::integral_constant<bool, simd_partition_copy_applies<_RandomAccessIterator, _OutputIterator1,
+                                                                   _OutputIterator2, _PredicateFunc>::value>
+      use_simd;
+  return __partition_copy(first, last, d_true, d_false, p, use_simd());
+}
+
+/**
+ * Helper method: counts the elements of every block of PARTITION_BLOCK_SIZE elements in [first, last) that satisfy `p`
+ * in parallel, and turns the counts into offsets as flag_blocks does, without storing the individual results.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+void count_blocks(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                  typename std::iterator_traits<_RandomAccessIterator>::difference_type *offsets) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = num_partition_blocks(range_width);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    diff_t count = 0;
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k)
+      count += (bool)p(*(first + k));
+    offsets[b] = count;
+  }
+  block_offsets(offsets, num_blocks);
+}
+
+/**
+ * Helper method: packs the elements of every block of [first, last) that satisfy `keep` at the front of the same block
+ * of `chunks` in parallel, writing each with `transfer(destination, source)` into uninitialized storage. The number of
+ * elements kept by each block is turned into offsets as flag_blocks does. `chunks` must have room for last - first
+ * elements, and `keep` is evaluated exactly once per element.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc, class _TransferFunc>
+void compact_blocks(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc keep,
+                    typename std::iterator_traits<_RandomAccessIterator>::value_type *chunks,
+                    typename std::iterator_traits<_RandomAccessIterator>::difference_type *offsets,
+                    _TransferFunc transfer) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  diff_t num_blocks = num_partition_blocks(range_width);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    value_t *out = chunks + b * PARTITION_BLOCK_SIZE;
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k) {
+      if (keep(*(first + k)))
+        transfer(out++, *(first + k));
+    }
+    offsets[b] = out - (chunks + b * PARTITION_BLOCK_SIZE);
+  }
+  block_offsets(offsets, num_blocks);
+}
+
+/**
+ * Helper method: concatenates the chunks packed by compact_blocks into the range beginning at `out` in parallel. Block
+ * `b` moves its elements to `out + offsets[b]` and destroys them in `chunks`.
+ */
+template <class _Type, class _DiffType, class _OutputIterator>
+void concatenate_blocks(_Type *chunks, _DiffType range_width, const _DiffType *offsets, _OutputIterator out) {
+  cilk_for(_DiffType b = 0; b < num_partition_blocks(range_width); ++b) {
+    _Type *chunk = chunks + b * PARTITION_BLOCK_SIZE;
+    _OutputIterator dest = out + offsets[b];
+    for (_DiffType k = 0; k < offsets[b + 1] - offsets[b]; ++k, ++dest) {
+      *dest = std::move(chunk[k]);
+      chunk[k].~_Type();
+    }
+  }
+}
+
+/**
+ * Helper method for copy_if into contiguous output of the input type, on contiguous arithmetic input with a threshold
+ * predicate. The blocks are counted with the SIMD kernels and then compressed directly into the output.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator __copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                          _PredicateFunc p, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  const value_t *in = &*first;
+
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  count_blocks_simd(in, range_width, p, offsets.data());
+  if (offsets.back() == 0)
+    return d_first;
+
+  value_t *out = &*d_first;
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    simd_compress(in + begin, (std::size_t)(end - begin), out + offsets[b], p);
+  }
+  return d_first + offsets.back();
+}
+
+/**
+ * Helper method for copy_if in the general case. The blocks count their elements satisfying `p` in parallel, and after
+ * a parallel exclusive scan over the counts every block evaluates `p` again while copying its elements to their
+ * destinations.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator __copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                          _PredicateFunc p, std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  count_blocks(first, last, p, offsets.data());
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t end = std::min(range_width, (b + 1) * PARTITION_BLOCK_SIZE);
+    _OutputIterator out = d_first + offsets[b];
+    for (diff_t k = b * PARTITION_BLOCK_SIZE; k < end; ++k) {
+      if (p(*(first + k)))
+        *out++ = *(first + k);
+    }
+  }
+  return d_first + offsets.back();
+}
+
+/**
+ * Defines whether copy_if and remove_copy_if can use the SIMD kernels, which requires contiguous arithmetic input with
+ * a threshold predicate and contiguous output of the input type
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc> struct simd_copy_if_applies {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  static constexpr bool value =
+      simd_partition_applies<_RandomAccessIterator, _PredicateFunc>::value &&
+      is_contiguous_iterator<_OutputIterator>::value &&
+      std::is_same<value_t, typename std::iterator_traits<_OutputIterator>::value_type>::value;
+};
+
+/**
+ * Implements spec from std::copy_if with two parallel passes over blocks of PARTITION_BLOCK_SIZE elements: the first
+ * counts the elements satisfying `p` in every block, and after a parallel exclusive scan over the counts the second
+ * copies them to their destinations. The predicate is therefore evaluated twice per element; copy_if_single_pass
+ * evaluates it once. The output iterator must support random access. Contiguous arithmetic input filtered by a
+ * ThresholdPredicate into contiguous output is handled by the SIMD compress kernels.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                        _PredicateFunc p) {
+  if (last - first < PARTITION_GS) {
+    return std::copy_if(first, last, d_first, p);
+  }
+  typedef std::integral_constant<bool,
+                                simd_copy_if_applies<_RandomAccessIterator, _OutputIterator, _PredicateFunc>::value>
+      use_simd;
+  return __copy_if(first, last, d_first, p, use_simd());
+}
+
+/**
+ * Implements spec from std::copy_if in a single parallel pass for predicates that are expensive or must run only once
+ * per element. Every block copies its elements satisfying `p` into its own chunk of scratch storage, and the chunks are
+ * then concatenated into the output in parallel at offsets given by a parallel scan over their lengths. The output
+ * iterator must support random access.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator copy_if_single_pass(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                                    _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  if (range_width < PARTITION_GS) {
+    return std::copy_if(first, last, d_first, p);
+  }
+
+  UninitializedBuffer<value_t> chunks(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  auto construct = [](value_t *dest, const value_t &src) { new (dest) value_t(src); };
+  compact_blocks(first, last, p, chunks.data(), offsets.data(), construct);
+  concatenate_blocks(chunks.data(), range_width, offsets.data(), d_first);
+  return d_first + offsets.back();
+}
+
+/**
+ * Helper method for remove_copy_if on inputs accepted by simd_copy_if_applies. The SIMD kernels count the elements
+ * satisfying `p`, whose prefix also gives the destinations of the remaining elements, and then compress the remaining
+ * elements of every block directly into the output.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator __remove_copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                                 _PredicateFunc p, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  const value_t *in = &*first;
+
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  count_blocks_simd(in, range_width, p, offsets.data());
+  if (offsets.back() == range_width)
+    return d_first;
+
+  value_t *out = &*d_first;
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    simd_compress_not(in + begin, (std::size_t)(end - begin), out + (begin - offsets[b]), p);
+  }
+  return d_first + (range_width - offsets.back());
+}
+
+/**
+ * Helper method for remove_copy_if in the general case, which is copy_if with the negated predicate
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator __remove_copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                                 _PredicateFunc p, std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  auto keep = [&](const value_t &v) { return !p(v); };
+  return __copy_if(first, last, d_first, keep, std::false_type());
+}
+
+/**
+ * Implements spec from std::remove_copy_if by copying the elements that do not satisfy `p` with the two pass scheme of
+ * copy_if. The output iterator must support random access.
+ */
+template <class _RandomAccessIterator, class _OutputIterator, class _PredicateFunc>
+_OutputIterator remove_copy_if(_RandomAccessIterator first, _RandomAccessIterator last, _OutputIterator d_first,
+                               _PredicateFunc p) {
+  if (last - first < PARTITION_GS) {
+    return std::remove_copy_if(first, last, d_first, p);
+  }
+  typedef std::integral_constant<bool,
+                                simd_copy_if_applies<_RandomAccessIterator, _OutputIterator, _PredicateFunc>::value>
+      use_simd;
+  return __remove_copy_if(first, last, d_first, p, use_simd());
+}
+
+/**
+ * Helper method for remove_if on contiguous arithmetic input with a threshold predicate. The SIMD kernels compress the
+ * elements to keep from every block into its chunk of scratch storage and count them in the same pass.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator __remove_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                                  std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  const value_t *in = &*first;
+
+  UninitializedBuffer<value_t> chunks(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  cilk_for(diff_t b = 0; b < num_partition_blocks(range_width); ++b) {
+    diff_t begin = b * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(range_width, begin + PARTITION_BLOCK_SIZE);
+    offsets[b] = (diff_t)simd_compress_not(in + begin, (std::size_t)(end - begin), chunks.data() + begin, p);
+  }
+  block_offsets(offsets.data(), num_partition_blocks(range_width));
+  concatenate_blocks(chunks.data(), range_width, offsets.data(), first);
+  return first + offsets.back();
+}
+
+/**
+ * Helper method for remove_if in the general case. The elements to keep are moved into per-block chunks of scratch
+ * storage in one pass and moved back in a second.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator __remove_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                                  std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+
+  UninitializedBuffer<value_t> chunks(range_width);
+  std::vector<diff_t> offsets(num_partition_blocks(range_width) + 1);
+  auto keep = [&](const value_t &v) { return !p(v); };
+  auto construct = [](value_t *dest, value_t &src) { new (dest) value_t(std::move(src)); };
+  compact_blocks(first, last, keep, chunks.data(), offsets.data(), construct);
+  concatenate_blocks(chunks.data(), range_width, offsets.data(), first);
+  return first + offsets.back();
+}
+
+/**
+ * Implements spec from std::remove_if. Since blocks cannot compact themselves in place without overwriting elements
+ * that other blocks have yet to read, every block moves the elements it keeps into its own chunk of scratch storage,
+ * evaluating `p` once per element, and the chunks are then moved back to the front of the range in parallel. The
+ * elements past the returned iterator are left in a valid but unspecified state, as with std::remove_if.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator remove_if(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  if (last - first < PARTITION_GS) {
+    return std::remove_if(first, last, p);
+  }
+  typedef std::integral_constant<bool, simd_partition_applies<_RandomAccessIterator, _PredicateFunc>::value> use_simd;
+  return __remove_if(first, last, p, use_simd());
+}
+
+/**
+ * Implements spec from std::remove by way of remove_if
+ */
+template <class _RandomAccessIterator, class _Type>
+_RandomAccessIterator remove(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &value) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  return cilkstl::__parallel::remove_if(first, last, [&](const value_t &v) { return v == value; });
+}
+
+/**
+ * Helper method for partition_blocked: returns the number of elements of the contiguous range beginning at `first` that
+ * lie before the first cache line boundary. Returns 0 for ranges that are not contiguous and for elements whose size
+ * does not divide CACHE_LINE_SIZE, which cannot be aligned to cache lines.
+ */
+template <class _RandomAccessIterator>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type cache_line_head(_RandomAccessIterator first,
+                                                                                      std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  if (CACHE_LINE_SIZE % sizeof(value_t) != 0)
+    return 0;
+  std::uintptr_t address = (std::uintptr_t)&*first;
+  return (diff_t)((CACHE_LINE_SIZE - address % CACHE_LINE_SIZE) % CACHE_LINE_SIZE / sizeof(value_t));
+}
+
+template <class _RandomAccessIterator>
+typename std::iterator_traits<_RandomAccessIterator>::difference_type cache_line_head(_RandomAccessIterator,
+                                                                                      std::false_type) {
+  return 0;
+}
+
+/**
+ * Computes an in-place parallel partition over contiguous chunks. The sequence is split into a few chunks per worker
+ * whose lengths are multiples of a cache line, and every chunk is partitioned serially with branchless_partition in
+ * parallel. On contiguous input whose element size divides the cache line, the chunk boundaries are placed on cache
+ * line boundaries and the elements before the first boundary are added to the first chunk, so no two chunks share a
+ * cache line. The chunk results leave two sets of misplaced elements: the elements
+ * failing `p` that lie before the final partition point, and the elements satisfying `p` that lie after it. Both
+ * sets consist of at most one run per chunk and have the same size. The runs are lined up by prefix sums over their
+ * lengths, and the misplaced elements are exchanged pairwise in parallel, in pieces of PARTITION_BLOCK_SIZE swaps.
+ * Every element is moved at most once after its chunk is partitioned.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator partition_blocked(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  if (range_width < PARTITION_GS) {
+    return branchless_partition(first, last, p);
+  }
+
+  // Chooses the chunk size as a multiple of the number of elements per cache line
+  diff_t line = std::max((diff_t)1, (diff_t)(CACHE_LINE_SIZE / sizeof(value_t)));
+  diff_t max_chunks = (diff_t)PARTITION_CHUNKS_PER_WORKER * __cilkrts_get_nworkers();
+  diff_t num_chunks = std::max((diff_t)1, std::min(range_width / PARTITION_GS, max_chunks));
+  diff_t chunk_size = ((range_width + num_chunks - 1) / num_chunks + line - 1) / line * line;
+  diff_t head =
+      cache_line_head(first, std::integral_constant<bool, is_contiguous_iterator<_RandomAccessIterator>::value>());
+  num_chunks = std::max((diff_t)1, (range_width - head + chunk_size - 1) / chunk_size);
+  auto chunk_begin = [&](diff_t c) { return (c == 0) ? (diff_t)0 : std::min(range_width, head + c * chunk_size); };
+
+  // Partitions every chunk in parallel
+  std::vector<diff_t> chunk_true(num_chunks);
+  cilk_for(diff_t c = 0; c < num_chunks; ++c) {
+    _RandomAccessIterator s = first + chunk_begin(c);
+    _RandomAccessIterator e = first + chunk_begin(c + 1);
+    chunk_true[c] = branchless_partition(s, e, p) - s;
+  }
+  diff_t num_true = 0;
+  for (diff_t c = 0; c < num_chunks; ++c)
+    num_true += chunk_true[c];
+
+  // Collects the runs of misplaced elements in every chunk, along with prefix sums over their lengths
+  std::vector<diff_t> false_start, false_prefix(1, 0), true_start, true_prefix(1, 0);
+  for (diff_t c = 0; c < num_chunks; ++c) {
+    diff_t s = chunk_begin(c);
+    diff_t e = chunk_begin(c + 1);
+    diff_t m = s + chunk_true[c];
+    if (m < num_true && m < e) {
+      false_start.push_back(m);
+      false_prefix.push_back(false_prefix.back() + std::min(e, num_true) - m);
+    }
+    if (m > num_true && m > s) {
+      diff_t t = std::max(s, num_true);
+      true_start.push_back(t);
+      true_prefix.push_back(true_prefix.back() + m - t);
+    }
+  }
+
+  // Swaps the k-th misplaced false element with the k-th misplaced true element for all k in parallel
+  diff_t misplaced = false_prefix.back();
+  cilk_for(diff_t piece = 0; piece < num_partition_blocks(misplaced); ++piece) {
+    diff_t k = piece * PARTITION_BLOCK_SIZE;
+    diff_t end = std::min(misplaced, k + PARTITION_BLOCK_SIZE);
+    diff_t fi = std::upper_bound(false_prefix.begin(), false_prefix.end(), k) - false_prefix.begin() - 1;
+    diff_t ti = std::upper_bound(true_prefix.begin(), true_prefix.end(), k) - true_prefix.begin() - 1;
+    while (k < end) {
+      _RandomAccessIterator f = first + false_start[fi] + (k - false_prefix[fi]);
+      _RandomAccessIterator t = first + true_start[ti] + (k - true_prefix[ti]);
+      diff_t run = std::min(end, std::min(false_prefix[fi + 1], true_prefix[ti + 1])) - k;
+      std::swap_ranges(f, f + run, t);
+      k += run;
+      if (k == false_prefix[fi + 1])
+        ++fi;
+      if (k == true_prefix[ti + 1])
+        ++ti;
+    }
+  }
+
+  return first + num_true;
+}
+
+/**
+ * Implements spec from std::partition with partition_blocked: every task partitions its own contiguous, cache line
+ * aligned chunk, and the misplaced elements are exchanged in parallel afterwards. The span does not depend on how the
+ * two classes are distributed, so all-true, all-false and already partitioned inputs stay parallel.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator partition(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  return cilkstl::__parallel::partition_blocked(first, last, p);
+}
+
+/**
+ * Helper method: converts the block-major matrix `counts`, which holds the number of elements of each of `k` buckets in
+ * each of `num_blocks` blocks, into the output position of the first element of every (block, bucket) pair. The matrix
+ * is transposed into bucket-major order, scanned with the parallel exclusive_scan_inplace and transposed back. Returns
+ * the starting position of every bucket in the output, followed by the total number of elements.
+ */
+template <class _DiffType>
+std::vector<_DiffType> bucket_offsets(std::vector<_DiffType> &counts, _DiffType num_blocks, _DiffType k) {
+  std::vector<_DiffType> bucket_major(num_blocks * k + 1, 0);
+  cilk_for(_DiffType c = 0; c < k; ++c) {
+    for (_DiffType b = 0; b < num_blocks; ++b)
+      bucket_major[c * num_blocks + b] = counts[b * k + c];
+  }
+  cilkstl::__parallel::exclusive_scan_inplace(bucket_major.begin(), bucket_major.end(), (_DiffType)0);
+  cilk_for(_DiffType b = 0; b < num_blocks; ++b) {
+    for (_DiffType c = 0; c < k; ++c)
+      counts[b * k + c] = bucket_major[c * num_blocks + b];
+  }
+
+  std::vector<_DiffType> bucket_start(k + 1);
+  cilk_for(_DiffType c = 0; c <= k; ++c) { bucket_start[c] = bucket_major[c * num_blocks]; }
+  return bucket_start;
+}
+
+/**
+ * Computes a stable parallel k-way partition of [first, last), where `classifier` maps every element to a bucket in
+ * [0, k). The sequence is split into blocks that count the elements of each bucket in parallel, a prefix over the
+ * k-by-blocks matrix of counts assigns every (block, bucket) pair its destination, and the blocks scatter their elements
+ * into uninitialized scratch storage in parallel, from which they are moved back. The classifier is evaluated once per
+ * element. Returns the k + 1 bucket boundaries, so that bucket `c` ends up in [first + r[c], first + r[c + 1]). The
+ * number of blocks is limited to max(1, n / k), so the matrix holds at most max(n, k) counters and the extra memory is
+ * O(n + k); a large `k` costs O(k) memory and time even on a short range. `k` must be at most 2^32, since bucket ids
+ * are stored in 32 bits. If `k` is not positive the range is left unchanged and {0} is returned.
+ */
+template <class _RandomAccessIterator, class _ClassifierFunc>
+std::vector<typename std::iterator_traits<_RandomAccessIterator>::difference_type>
+partition_by(_RandomAccessIterator first, _RandomAccessIterator last, _ClassifierFunc classifier,
+             typename std::iterator_traits<_RandomAccessIterator>::difference_type k) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+  if (k <= 0)
+    return std::vector<diff_t>(1, 0);
+  if (range_width == 0)
+    return std::vector<diff_t>(k + 1, 0);
+
+  diff_t num_blocks = std::max((diff_t)1, std::min(num_partition_blocks(range_width), range_width / k));
+  diff_t block_size = (range_width + num_blocks - 1) / num_blocks;
+
+  // Classifies every element and builds one histogram per block, stored block-major in `counts`
+  TemporaryBuffer<std::uint32_t> classes(range_width);
+  std::uint32_t *cls = classes.data();
+  std::vector<diff_t> counts(num_blocks * k, 0);
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t *hist = counts.data() + b * k;
+    diff_t end = std::min(range_width, (b + 1) * block_size);
+    for (diff_t i = b * block_size; i < end; ++i) {
+      cls[i] = (std::uint32_t)classifier(*(first + i));
+      ++hist[cls[i]];
+    }
+  }
+  std::vector<diff_t> bucket_start = bucket_offsets(counts, num_blocks, k);
+
+  // Scatters every block into the buffer in parallel and moves the result back into the original range
+  UninitializedBuffer<value_t> buffer(range_width);
+  value_t *out = buffer.data();
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t *offsets = counts.data() + b * k;
+    diff_t end = std::min(range_width, (b + 1) * block_size);
+    for (diff_t i = b * block_size; i < end; ++i)
+      new (out + offsets[cls[i]]++) value_t(std::move(*(first + i)));
+  }
+  cilk_for(diff_t i = 0; i < range_width; ++i) {
+    *(first + i) = std::move(*(out + i));
+    (out + i)->~value_t();
+  }
+
+  return bucket_start;
+}
+
+/**
+ * Computes a stable parallel three-way partition of [first, last) around `pivot` using the comparison operator `comp`:
+ * the elements less than `pivot` come first, then the elements equivalent to it, then the greater elements. Returns the
+ * range holding the elements equivalent to `pivot`.
+ */
+template <class _RandomAccessIterator, class _Type, class _CompareFunc>
+std::pair<_RandomAccessIterator, _RandomAccessIterator>
+partition_three_way(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &pivot, _CompareFunc comp) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  auto classifier = [&](const value_t &v) { return comp(v, pivot) ? 0 : (comp(pivot, v) ? 2 : 1); };
+  auto bounds = cilkstl::__parallel::partition_by(first, last, classifier, 3);
+  return std::make_pair(first + bounds[1], first + bounds[2]);
+}
+
+/**
+ * Computes a stable parallel three-way partition of [first, last) around `pivot` using operator<
+ */
+template <class _RandomAccessIterator, class _Type>
+std::pair<_RandomAccessIterator, _RandomAccessIterator>
+partition_three_way(_RandomAccessIterator first, _RandomAccessIterator last, const _Type &pivot) {
+  return cilkstl::__parallel::partition_three_way(first, last, pivot, std::less<>());
+}
+
+/**
+ * Helper function for is_partitioned that splits the problem into halves and recurses in parallel, clearing the atomic
+ * flag `partitioned` when an element failing `p` is found directly before an element satisfying it. Each recursive call
+ * is prefaced by a check to the flag so that the remaining work is cancelled as soon as the first violation is seen.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+void __is_partitioned(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p,
+                      std::atomic<bool> &partitioned) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (!partitioned.load(std::memory_order_relaxed))
+    return;
+
+  // default to serial code if problem size is too small
+  if (range_width < PARTITION_GS) {
+    if (!std::is_partitioned(first, last, p))
+      partitioned.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  _RandomAccessIterator middle = first + (range_width / 2);
+
+  // handle edge case where middle - 1 is in left spawn but middle is in right spawn
+  if (!p(*(middle - 1)) && p(*middle)) {
+    partitioned.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  // recursively spawn left and right halves
+  cilk_spawn cilkstl::__parallel::__is_partitioned(first, middle, p, partitioned);
+  cilkstl::__parallel::__is_partitioned(middle, last, p, partitioned);
+  cilk_sync;
+}
+
+/**
+ * Implements spec from std::is_partitioned by splitting the array in half and recursively solving each half in
+ * parallel, cancelling outstanding work once a violation is found. A range is partitioned exactly when no element
+ * failing `p` is directly followed by an element satisfying it, so the halves can be checked independently.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+bool is_partitioned(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  if (last - first < 2)
+    return true;
+
+  std::atomic<bool> partitioned(true);
+  cilkstl::__parallel::__is_partitioned(first, last, p, partitioned);
+  return partitioned.load();
+}
+
+/**
+ * Implements spec from std::partition_point by binary search, which requires [first, last) to be partitioned by `p`.
+ * The search takes O(log n) evaluations of `p` and is not worth parallelizing; batch_partition_point answers many
+ * queries in parallel instead.
+ */
+template <class _RandomAccessIterator, class _PredicateFunc>
+_RandomAccessIterator partition_point(_RandomAccessIterator first, _RandomAccessIterator last, _PredicateFunc p) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  while (range_width > 0) {
+    diff_t half = range_width / 2;
+    _RandomAccessIterator middle = first + half;
+    if (p(*middle)) {
+      first = middle + 1;
+      range_width -= half + 1;
+    } else {
+      range_width = half;
+    }
+  }
+  return first;
+}
+
+/**
+ * Computes the partition point of [first, last) for every predicate in [p_first, p_last) in parallel, writing the
+ * result for predicate `p_first + i` to `d_first + i`. The range must be partitioned by every predicate, as for
+ * partition_point. The output iterator must support random access. Returns the end of the output range.
+ */
+template <class _RandomAccessIterator, class _PredicateIterator, class _OutputIterator>
+_OutputIterator batch_partition_point(_RandomAccessIterator first, _RandomAccessIterator last,
+                                      _PredicateIterator p_first, _PredicateIterator p_last, _OutputIterator d_first) {
+  typedef typename std::iterator_traits<_PredicateIterator>::difference_type diff_t;
+  diff_t num_queries = p_last - p_first;
+  cilk_for(diff_t q = 0; q < num_queries; ++q) {
+    *(d_first + q) = cilkstl::__parallel::partition_point(first, last, *(p_first + q));
+  }
+  return d_first + num_queries;
 }
 
 } // namespace __parallel
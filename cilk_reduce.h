@@ -0,0 +1,134 @@
+#ifndef CILKSTL_REDUCE_H
+#define CILKSTL_REDUCE_H
+
+#include <cilk/cilk.h>
+
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace cilkstl {
+namespace __parallel {
+
+constexpr int REDUCE_GRAIN = 8192;       // number of elements below which a range is reduced serially into a local
+constexpr int REDUCE_SIMD_GRAIN = 65536; // the same for the SIMD kernels, which get through a block much faster
+
+/**
+ * This file implements parallel reductions without hyperobjects. The index range is split in halves recursively down
+ * to blocks of REDUCE_GRAIN elements; every block accumulates into a local variable in a tight loop the compiler can
+ * vectorize, and the block results are combined pairwise on the way back up. The combination tree follows the order of
+ * the range, so the operators need to be associative but not commutative.
+ */
+
+/**
+ * Helper method that returns the combination under `combine` of `block(start, end)` over the blocks of the nonempty
+ * index range [start, end), in order. `block` must reduce a nonempty index range of at most `grain` elements serially.
+ */
+template <class _Sum, class _DiffType, class _BlockFunc, class _CombineOp>
+_Sum __reduce_range(_DiffType start, _DiffType end, _BlockFunc &block, _CombineOp &combine,
+                    _DiffType grain = REDUCE_GRAIN) {
+  _DiffType range_width = end - start;
+  if (range_width <= grain)
+    return block(start, end);
+
+  _DiffType middle = start + range_width / 2;
+  _Sum left = cilk_spawn cilkstl::__parallel::__reduce_range<_Sum>(start, middle, block, combine, grain);
+  _Sum right = cilkstl::__parallel::__reduce_range<_Sum>(middle, end, block, combine, grain);
+  cilk_sync;
+  return combine(std::move(left), std::move(right));
+}
+
+/**
+ * Helper method that reduces [first, last) under `op` starting from `init`, applying `unary` to every element
+ */
+template <class _RandomAccessIterator, class _Type, class _BinaryOp, class _UnaryOp>
+_Type __transform_reduce(_RandomAccessIterator first, _RandomAccessIterator last, _Type init, _BinaryOp op,
+                         _UnaryOp unary) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (range_width <= 0)
+    return init;
+
+  auto block = [first, &op, &unary](diff_t start, diff_t end) {
+    _Type sum = unary(first[start]);
+    for (diff_t i = start + 1; i < end; ++i)
+      sum = op(std::move(sum), unary(first[i]));
+    return sum;
+  };
+  return op(std::move(init), cilkstl::__parallel::__reduce_range<_Type>((diff_t)0, range_width, block, op));
+}
+
+/**
+ * Implements spec from std::reduce with the binary operation `op` and initial value `init`. The elements are combined
+ * in a fixed tree order, so the result is deterministic for a given range size and `op` only needs to be associative.
+ */
+template <class _RandomAccessIterator, class _Type, class _BinaryOp>
+_Type reduce(_RandomAccessIterator first, _RandomAccessIterator last, _Type init, _BinaryOp op) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::reference ref_t;
+  return cilkstl::__parallel::__transform_reduce(first, last, init, op, [](ref_t x) -> ref_t { return x; });
+}
+
+/**
+ * Implements spec from std::reduce with std::plus and initial value `init`
+ */
+template <class _RandomAccessIterator, class _Type>
+_Type reduce(_RandomAccessIterator first, _RandomAccessIterator last, _Type init) {
+  return cilkstl::__parallel::reduce(first, last, init, std::plus<>());
+}
+
+/**
+ * Implements spec from std::reduce with std::plus, starting from a value-initialized element
+ */
+template <class _RandomAccessIterator>
+typename std::iterator_traits<_RandomAccessIterator>::value_type reduce(_RandomAccessIterator first,
+                                                                        _RandomAccessIterator last) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  return cilkstl::__parallel::reduce(first, last, value_t(), std::plus<>());
+}
+
+/**
+ * Implements spec from std::transform_reduce over one range, applying `unary` to every element before reducing with
+ * `op` starting from `init`
+ */
+template <class _RandomAccessIterator, class _Type, class _BinaryOp, class _UnaryOp>
+_Type transform_reduce(_RandomAccessIterator first, _RandomAccessIterator last, _Type init, _BinaryOp op,
+                       _UnaryOp unary) {
+  return cilkstl::__parallel::__transform_reduce(first, last, init, op, unary);
+}
+
+/**
+ * Implements spec from std::transform_reduce over two ranges, applying `transform` to every pair of elements before
+ * reducing with `op` starting from `init`
+ */
+template <class _RandomAccessIterator1, class _RandomAccessIterator2, class _Type, class _BinaryOp,
+          class _BinaryTransform>
+_Type transform_reduce(_RandomAccessIterator1 first1, _RandomAccessIterator1 last1, _RandomAccessIterator2 first2,
+                       _Type init, _BinaryOp op, _BinaryTransform transform) {
+  typedef typename std::iterator_traits<_RandomAccessIterator1>::difference_type diff_t;
+  diff_t range_width = last1 - first1;
+  if (range_width <= 0)
+    return init;
+
+  auto block = [first1, first2, &op, &transform](diff_t start, diff_t end) {
+    _Type sum = transform(first1[start], first2[start]);
+    for (diff_t i = start + 1; i < end; ++i)
+      sum = op(std::move(sum), transform(first1[i], first2[i]));
+    return sum;
+  };
+  return op(std::move(init), cilkstl::__parallel::__reduce_range<_Type>((diff_t)0, range_width, block, op));
+}
+
+/**
+ * Implements spec from std::transform_reduce over two ranges as an inner product with std::plus and std::multiplies
+ */
+template <class _RandomAccessIterator1, class _RandomAccessIterator2, class _Type>
+_Type transform_reduce(_RandomAccessIterator1 first1, _RandomAccessIterator1 last1, _RandomAccessIterator2 first2,
+                       _Type init) {
+  return cilkstl::__parallel::transform_reduce(first1, last1, first2, init, std::plus<>(), std::multiplies<>());
+}
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef CILKSTL_REDUCER_H
+#define CILKSTL_REDUCER_H
+
+#include <cilk/cilk.h>
+
+#include <functional>
+#include <new>
+#include <type_traits>
+
+namespace cilkstl {
+namespace __parallel {
+
+/**
+ * This file implements reducers on the hyperobject type qualifier `T cilk_reducer(identity, reduce)` of OpenCilk 2.x,
+ * which replaces the deprecated cilk::reducer library. A reducer declared this way is a plain variable of type `T`:
+ * updates go straight to the current view without the wrapper object and virtual monoid calls of the legacy library.
+ * The runtime calls `identity` on raw storage for every new view and `reduce(left, right)` to fold a view into the
+ * view of the strand that precedes it. Views are not destroyed by the callbacks, so view types must be trivially
+ * destructible.
+ *
+ * The reducer aliases are only defined when the compiler provides the `cilk_reducer` keyword. The view types and their
+ * update and combine functions are always available. Where a loop body only accumulates, prefer the block reductions of
+ * cilk_reduce.h, which touch no hyperobject at all.
+ */
+
+/**
+ * View of the min and max reducers with index: the index and value of the extremum seen so far, if any
+ */
+template <class _IndexType, class _Type> struct IndexedValue {
+  bool has_value = false;
+  _IndexType index = _IndexType();
+  _Type value = _Type();
+};
+
+/**
+ * Updates `view` with the element `value` at `index` if it is larger under `comp` than the value seen so far. Updates
+ * must come in increasing index order within a strand, which keeps the first of equal largest elements.
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+void calc_max(IndexedValue<_IndexType, _Type> &view, _IndexType index, const _Type &value, _Compare comp = _Compare()) {
+  if (!view.has_value || comp(view.value, value)) {
+    view.has_value = true;
+    view.index = index;
+    view.value = value;
+  }
+}
+
+/**
+ * Updates `view` with the element `value` at `index` if it is smaller under `comp` than the value seen so far, keeping
+ * the first of equal smallest elements
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+void calc_min(IndexedValue<_IndexType, _Type> &view, _IndexType index, const _Type &value, _Compare comp = _Compare()) {
+  if (!view.has_value || comp(value, view.value)) {
+    view.has_value = true;
+    view.index = index;
+    view.value = value;
+  }
+}
+
+/**
+ * Folds `right` into `left`, where `right` covers elements after those of `left`, keeping the first largest element
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+void combine_max(IndexedValue<_IndexType, _Type> &left, const IndexedValue<_IndexType, _Type> &right,
+                 _Compare comp = _Compare()) {
+  if (right.has_value && (!left.has_value || comp(left.value, right.value)))
+    left = right;
+}
+
+/**
+ * Folds `right` into `left`, where `right` covers elements after those of `left`, keeping the first smallest element
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+void combine_min(IndexedValue<_IndexType, _Type> &left, const IndexedValue<_IndexType, _Type> &right,
+                 _Compare comp = _Compare()) {
+  if (right.has_value && (!left.has_value || comp(right.value, left.value)))
+    left = right;
+}
+
+/**
+ * Identity callback shared by the reducers: value-initializes a view in raw storage
+ */
+template <class _View> void reducer_identity(void *view) {
+  static_assert(std::is_trivially_destructible<_View>::value, "reducer views are never destroyed");
+  new (view) _View();
+}
+
+/**
+ * Reduce callback of the add reducer
+ */
+template <class _Type> void reducer_add(void *left, void *right) {
+  *static_cast<_Type *>(left) += *static_cast<_Type *>(right);
+}
+
+/**
+ * Reduce callback of the max reducer with index; `_Compare` is default constructed
+ */
+template <class _View, class _Compare> void reducer_max(void *left, void *right) {
+  cilkstl::__parallel::combine_max(*static_cast<_View *>(left), *static_cast<_View *>(right), _Compare());
+}
+
+/**
+ * Reduce callback of the min reducer with index; `_Compare` is default constructed
+ */
+template <class _View, class _Compare> void reducer_min(void *left, void *right) {
+  cilkstl::__parallel::combine_min(*static_cast<_View *>(left), *static_cast<_View *>(right), _Compare());
+}
+
+#ifdef cilk_reducer
+
+/**
+ * Sum reducer, for example for counts: `add_reducer<long> sum = 0;` then `sum += x;` in a cilk_for body
+ */
+template <class _Type> using add_reducer = _Type cilk_reducer(reducer_identity<_Type>, reducer_add<_Type>);
+
+/**
+ * Max reducer with index: `max_index_reducer<long, double> best;` then `calc_max(best, i, v[i]);` in a cilk_for body.
+ * The result keeps the first of equal largest elements, as std::max_element does.
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+using max_index_reducer =
+    IndexedValue<_IndexType, _Type> cilk_reducer(reducer_identity<IndexedValue<_IndexType, _Type>>,
+                                                 reducer_max<IndexedValue<_IndexType, _Type>, _Compare>);
+
+/**
+ * Min reducer with index, keeping the first of equal smallest elements as std::min_element does
+ */
+template <class _IndexType, class _Type, class _Compare = std::less<_Type>>
+using min_index_reducer =
+    IndexedValue<_IndexType, _Type> cilk_reducer(reducer_identity<IndexedValue<_IndexType, _Type>>,
+                                                 reducer_min<IndexedValue<_IndexType, _Type>, _Compare>);
+
+#endif // cilk_reducer
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
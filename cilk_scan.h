@@ -0,0 +1,629 @@
+#ifndef CILKSTL_SCAN_H
+#define CILKSTL_SCAN_H
+
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+
+#include "cilk_simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cilkstl {
+namespace __parallel {
+
+constexpr int SCAN_GRAIN = 16384;         // minimum number of elements per block, below twice this scans are serial
+constexpr int SCAN_BLOCKS_PER_WORKER = 4; // number of blocks per cilk worker
+constexpr int SCAN_LOOKBACK_BLOCK = 8192; // elements per block in the single pass scans, sized to stay in cache
+constexpr int SCAN_LOOKBACK_SPINS = 64;   // busy waits on a predecessor block before yielding the thread
+
+/**
+ * This file implements parallel prefix scans with arbitrary associative operators. They use the reduce-then-scan
+ * scheme: the range is split into a few blocks per worker, every block is reduced in parallel, a short serial scan
+ * over the block sums gives each block its carry-in, and every block is then scanned in parallel starting from its
+ * carry-in. The span is O(n / p + p). Every output element is written by the block that reads the corresponding input
+ * element, so the output range may equal the input range. This reads the input twice; the single pass variants at
+ * the end of the file read it once, at the cost of blocks waiting on their predecessors.
+ */
+
+/**
+ * Unary operation used by the scans that do not transform their input
+ */
+struct ScanIdentity {
+  template <class _Type> const _Type &operator()(const _Type &x) const { return x; }
+};
+
+/**
+ * Helper method that returns the number of blocks a scan over `range_width` elements is split into
+ */
+template <class _DiffType> _DiffType scan_num_blocks(_DiffType range_width) {
+  _DiffType max_blocks = (_DiffType)(SCAN_BLOCKS_PER_WORKER * __cilkrts_get_nworkers());
+  return std::max((_DiffType)1, std::min(range_width / SCAN_GRAIN, max_blocks));
+}
+
+/**
+ * Defines whether a scan with accumulator type `_Sum` can run on the SIMD kernels: input and output must be
+ * contiguous storage of `_Sum`, a 32 or 64-bit integer, the operator must be std::plus and the input must not be
+ * transformed
+ */
+template <class _InputIterator, class _OutputIterator, class _Sum, class _BinaryOp, class _UnaryOp>
+struct simd_scan_applies {
+  static constexpr bool value =
+      is_contiguous_iterator<_InputIterator>::value && is_contiguous_iterator<_OutputIterator>::value &&
+      std::is_same<typename std::iterator_traits<_InputIterator>::value_type, _Sum>::value &&
+      std::is_same<typename std::iterator_traits<_OutputIterator>::value_type, _Sum>::value &&
+      simd_add_type<_Sum>::value &&
+      (std::is_same<_BinaryOp, std::plus<_Sum>>::value || std::is_same<_BinaryOp, std::plus<>>::value) &&
+      std::is_same<_UnaryOp, ScanIdentity>::value;
+};
+
+/**
+ * Helper method: returns the reduction of `unary` applied to every element of the nonempty range [first, last) under
+ * `op`, in order
+ */
+template <class _Sum, class _InputIterator, class _BinaryOp, class _UnaryOp>
+_Sum scan_block_reduce(_InputIterator first, _InputIterator last, _BinaryOp op, _UnaryOp unary, std::false_type) {
+  _Sum sum = unary(*first);
+  for (++first; first != last; ++first)
+    sum = op(sum, unary(*first));
+  return sum;
+}
+
+template <class _Sum, class _InputIterator, class _BinaryOp, class _UnaryOp>
+_Sum scan_block_reduce(_InputIterator first, _InputIterator last, _BinaryOp, _UnaryOp, std::true_type) {
+  return simd_reduce_add(&*first, (std::size_t)(last - first));
+}
+
+/**
+ * Helper method: scans [first, last) serially into the range beginning at `d_first`, starting from `carry`, and returns
+ * the reduction of `carry` with the whole range. If `_Inclusive` is false, element `i` of the output excludes input
+ * element `i`. Each input element is read before the corresponding output element is written.
+ */
+template <bool _Inclusive, class _InputIterator, class _OutputIterator, class _Sum, class _BinaryOp, class _UnaryOp>
+_Sum scan_block(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Sum carry, _BinaryOp op,
+                _UnaryOp unary, std::false_type) {
+  for (; first != last; ++first, ++d_first) {
+    if (_Inclusive) {
+      carry = op(carry, unary(*first));
+      *d_first = carry;
+    } else {
+      _Sum next = op(carry, unary(*first));
+      *d_first = carry;
+      carry = std::move(next);
+    }
+  }
+  return carry;
+}
+
+template <bool _Inclusive, class _InputIterator, class _OutputIterator, class _Sum, class _BinaryOp, class _UnaryOp>
+_Sum scan_block(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Sum carry, _BinaryOp, _UnaryOp,
+                std::true_type) {
+  if (first == last)
+    return carry;
+  return simd_scan_add<_Inclusive>(&*first, (std::size_t)(last - first), &*d_first, carry);
+}
+
+/**
+ * Helper method that scans [first, last) into the range beginning at `d_first` starting from `init` with the
+ * reduce-then-scan scheme. Returns the end of the output range.
+ */
+template <bool _Inclusive, class _InputIterator, class _OutputIterator, class _Sum, class _BinaryOp, class _UnaryOp>
+_OutputIterator __scan(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Sum init, _BinaryOp op,
+                       _UnaryOp unary) {
+  typedef typename std::iterator_traits<_InputIterator>::difference_type diff_t;
+  typedef std::integral_constant<
+      bool, simd_scan_applies<_InputIterator, _OutputIterator, _Sum, _BinaryOp, _UnaryOp>::value>
+      use_simd;
+  diff_t range_width = last - first;
+
+  // Defaults to serial implementation at small range sizes, or with a single worker where the second pass over the
+  // input would only add memory traffic
+  if (range_width < 2 * SCAN_GRAIN || __cilkrts_get_nworkers() == 1) {
+    scan_block<_Inclusive>(first, last, d_first, init, op, unary, use_simd());
+    return d_first + range_width;
+  }
+
+  diff_t num_blocks = scan_num_blocks(range_width);
+  diff_t block_size = (range_width + num_blocks - 1) / num_blocks;
+
+  // Reduces every block but the last, and scans the block sums into the carry-in of every block
+  std::vector<_Sum> carries(num_blocks, init);
+  cilk_for(diff_t b = 0; b < num_blocks - 1; ++b) {
+    carries[b + 1] = scan_block_reduce<_Sum>(first + b * block_size, first + (b + 1) * block_size, op, unary,
+                                              use_simd());
+  }
+  for (diff_t b = 1; b < num_blocks; ++b)
+    carries[b] = op(carries[b - 1], carries[b]);
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t begin = b * block_size;
+    diff_t end = std::min(range_width, begin + block_size);
+    scan_block<_Inclusive>(first + begin, first + end, d_first + begin, carries[b], op, unary, use_simd());
+  }
+  return d_first + range_width;
+}
+
+/**
+ * Helper method for the inclusive scans without an initial value, which start from the first transformed element
+ */
+template <class _Sum, class _InputIterator, class _OutputIterator, class _BinaryOp, class _UnaryOp>
+_OutputIterator __inclusive_scan_no_init(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                         _BinaryOp op, _UnaryOp unary) {
+  if (first == last)
+    return d_first;
+  _Sum init = unary(*first);
+  *d_first = init;
+  return cilkstl::__parallel::__scan<true>(first + 1, last, d_first + 1, init, op, unary);
+}
+
+/**
+ * Implements spec from std::inclusive_scan with the binary operation `op` and initial value `init`, using the
+ * reduce-then-scan scheme described above. `op` must be associative. The output iterator must support random access and
+ * may equal `first`.
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp, class _Type>
+_OutputIterator inclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first, _BinaryOp op,
+                               _Type init) {
+  return cilkstl::__parallel::__scan<true>(first, last, d_first, init, op, ScanIdentity());
+}
+
+/**
+ * Implements spec from std::inclusive_scan with the binary operation `op`, accumulating in the value type of the input
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp>
+_OutputIterator inclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first, _BinaryOp op) {
+  typedef typename std::iterator_traits<_InputIterator>::value_type value_t;
+  return cilkstl::__parallel::__inclusive_scan_no_init<value_t>(first, last, d_first, op, ScanIdentity());
+}
+
+/**
+ * Implements spec from std::inclusive_scan with std::plus. Contiguous ranges of 32 and 64-bit integers are scanned
+ * with the SIMD kernels.
+ */
+template <class _InputIterator, class _OutputIterator>
+_OutputIterator inclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first) {
+  return cilkstl::__parallel::inclusive_scan(first, last, d_first, std::plus<>());
+}
+
+/**
+ * Implements spec from std::exclusive_scan with the binary operation `op` and initial value `init`, which also
+ * determines the accumulator type. `op` must be associative. The output iterator must support random access and may
+ * equal `first`.
+ */
+template <class _InputIterator, class _OutputIterator, class _Type, class _BinaryOp>
+_OutputIterator exclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Type init,
+                               _BinaryOp op) {
+  return cilkstl::__parallel::__scan<false>(first, last, d_first, init, op, ScanIdentity());
+}
+
+/**
+ * Implements spec from std::exclusive_scan with std::plus
+ */
+template <class _InputIterator, class _OutputIterator, class _Type>
+_OutputIterator exclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Type init) {
+  return cilkstl::__parallel::exclusive_scan(first, last, d_first, init, std::plus<>());
+}
+
+/**
+ * Implements spec from std::transform_inclusive_scan with initial value `init`, applying `unary` to every element
+ * before scanning with `op`
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp, class _UnaryOp, class _Type>
+_OutputIterator transform_inclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                         _BinaryOp op, _UnaryOp unary, _Type init) {
+  return cilkstl::__parallel::__scan<true>(first, last, d_first, init, op, unary);
+}
+
+/**
+ * Implements spec from std::transform_inclusive_scan, accumulating in the type returned by `unary`
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp, class _UnaryOp>
+_OutputIterator transform_inclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                         _BinaryOp op, _UnaryOp unary) {
+  typedef typename std::decay<decltype(unary(*first))>::type sum_t;
+  return cilkstl::__parallel::__inclusive_scan_no_init<sum_t>(first, last, d_first, op, unary);
+}
+
+/**
+ * Implements spec from std::transform_exclusive_scan, applying `unary` to every element before scanning with `op`
+ * starting from `init`
+ */
+template <class _InputIterator, class _OutputIterator, class _Type, class _BinaryOp, class _UnaryOp>
+_OutputIterator transform_exclusive_scan(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                         _Type init, _BinaryOp op, _UnaryOp unary) {
+  return cilkstl::__parallel::__scan<false>(first, last, d_first, init, op, unary);
+}
+
+/**
+ * Replaces every element of [first, last) by the reduction under `op` of the elements up to and including it
+ */
+template <class _RandomAccessIterator, class _BinaryOp>
+void inclusive_scan_inplace(_RandomAccessIterator first, _RandomAccessIterator last, _BinaryOp op) {
+  cilkstl::__parallel::inclusive_scan(first, last, first, op);
+}
+
+/**
+ * Replaces every element of [first, last) by the sum of the elements up to and including it
+ */
+template <class _RandomAccessIterator>
+void inclusive_scan_inplace(_RandomAccessIterator first, _RandomAccessIterator last) {
+  cilkstl::__parallel::inclusive_scan(first, last, first);
+}
+
+/**
+ * Replaces every element of [first, last) by the reduction under `op` of `init` and the elements before it
+ */
+template <class _RandomAccessIterator, class _Type, class _BinaryOp>
+void exclusive_scan_inplace(_RandomAccessIterator first, _RandomAccessIterator last, _Type init, _BinaryOp op) {
+  cilkstl::__parallel::exclusive_scan(first, last, first, init, op);
+}
+
+/**
+ * Replaces every element of [first, last) by the sum of `init` and the elements before it
+ */
+template <class _RandomAccessIterator, class _Type>
+void exclusive_scan_inplace(_RandomAccessIterator first, _RandomAccessIterator last, _Type init) {
+  cilkstl::__parallel::exclusive_scan(first, last, first, init);
+}
+
+/**
+ * Publication states of a block in the single pass scans
+ */
+enum ScanBlockStatus : unsigned char { SCAN_NOT_READY, SCAN_AGGREGATE_READY, SCAN_PREFIX_READY };
+
+/**
+ * Helper method that scans [first, last) into the range beginning at `d_first` starting from `init` in a single pass
+ * with decoupled look-back. Every block reduces its elements, publishes the aggregate, and then walks back over its
+ * predecessors, combining their aggregates until it reaches one that has published its inclusive prefix. It publishes
+ * its own inclusive prefix and scans its elements, which are still in cache, from the prefix of its predecessors.
+ *
+ * A block only waits on blocks with smaller indices, but under work stealing the tasks of a cilk_for do not start in
+ * index order, so a task spinning on a predecessor that has not started could wait forever. Tasks therefore draw their
+ * block index from an atomic ticket when they start: every smaller index has been drawn by a task that has already
+ * started and never waits on a later block, so the look-back always terminates.
+ */
+template <bool _Inclusive, class _InputIterator, class _OutputIterator, class _Sum, class _BinaryOp, class _UnaryOp>
+_OutputIterator __scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first, _Sum init,
+                                   _BinaryOp op, _UnaryOp unary) {
+  typedef typename std::iterator_traits<_InputIterator>::difference_type diff_t;
+  typedef std::integral_constant<
+      bool, simd_scan_applies<_InputIterator, _OutputIterator, _Sum, _BinaryOp, _UnaryOp>::value>
+      use_simd;
+  diff_t range_width = last - first;
+
+  // Defaults to serial implementation at small range sizes
+  if (range_width < 2 * SCAN_LOOKBACK_BLOCK || __cilkrts_get_nworkers() == 1) {
+    scan_block<_Inclusive>(first, last, d_first, init, op, unary, use_simd());
+    return d_first + range_width;
+  }
+
+  diff_t num_blocks = (range_width + SCAN_LOOKBACK_BLOCK - 1) / SCAN_LOOKBACK_BLOCK;
+  std::vector<std::atomic<unsigned char>> status(num_blocks);
+  for (diff_t b = 0; b < num_blocks; ++b)
+    status[b].store(SCAN_NOT_READY, std::memory_order_relaxed);
+  std::vector<_Sum> aggregates(num_blocks, init);
+  std::vector<_Sum> prefixes(num_blocks, init);
+  std::atomic<diff_t> ticket(0);
+
+  cilk_for(diff_t t = 0; t < num_blocks; ++t) {
+    diff_t b = ticket.fetch_add(1);
+    diff_t begin = b * SCAN_LOOKBACK_BLOCK;
+    diff_t end = std::min(range_width, begin + SCAN_LOOKBACK_BLOCK);
+    _Sum aggregate = scan_block_reduce<_Sum>(first + begin, first + end, op, unary, use_simd());
+
+    _Sum exclusive = init;
+    if (b == 0) {
+      prefixes[0] = op(init, aggregate);
+      status[0].store(SCAN_PREFIX_READY, std::memory_order_release);
+    } else {
+      aggregates[b] = aggregate;
+      status[b].store(SCAN_AGGREGATE_READY, std::memory_order_release);
+
+      // Combines the aggregates of the predecessors, right to left, up to the first published prefix
+      _Sum suffix = aggregate;
+      bool has_suffix = false;
+      for (diff_t j = b - 1;; --j) {
+        unsigned char state;
+        for (int spins = 0; (state = status[j].load(std::memory_order_acquire)) == SCAN_NOT_READY; ++spins) {
+          // Yields once the predecessor is slow to publish, in case its worker thread has been descheduled
+          if (spins >= SCAN_LOOKBACK_SPINS)
+            std::this_thread::yield();
+#ifdef CILKSTL_SIMD_X86
+          else
+            _mm_pause();
+#endif
+        }
+        if (state == SCAN_PREFIX_READY) {
+          exclusive = has_suffix ? op(prefixes[j], suffix) : prefixes[j];
+          break;
+        }
+        suffix = has_suffix ? op(aggregates[j], suffix) : aggregates[j];
+        has_suffix = true;
+      }
+      prefixes[b] = op(exclusive, aggregate);
+      status[b].store(SCAN_PREFIX_READY, std::memory_order_release);
+    }
+
+    scan_block<_Inclusive>(first + begin, first + end, d_first + begin, exclusive, op, unary, use_simd());
+  }
+  return d_first + range_width;
+}
+
+/**
+ * Computes the same result as inclusive_scan with `op` and `init` in a single pass over the input with decoupled
+ * look-back, so each input element is read from memory once and each output element written once. Prefer it over
+ * inclusive_scan for inputs much larger than the cache. The output iterator must support random access and may equal
+ * `first`.
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp, class _Type>
+_OutputIterator inclusive_scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                           _BinaryOp op, _Type init) {
+  return cilkstl::__parallel::__scan_single_pass<true>(first, last, d_first, init, op, ScanIdentity());
+}
+
+/**
+ * Computes the same result as inclusive_scan with `op` in a single pass, accumulating in the value type of the input
+ */
+template <class _InputIterator, class _OutputIterator, class _BinaryOp>
+_OutputIterator inclusive_scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                           _BinaryOp op) {
+  typedef typename std::iterator_traits<_InputIterator>::value_type value_t;
+  if (first == last)
+    return d_first;
+  value_t init = *first;
+  *d_first = init;
+  return cilkstl::__parallel::__scan_single_pass<true>(first + 1, last, d_first + 1, init, op, ScanIdentity());
+}
+
+/**
+ * Computes the same result as inclusive_scan with std::plus in a single pass
+ */
+template <class _InputIterator, class _OutputIterator>
+_OutputIterator inclusive_scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first) {
+  return cilkstl::__parallel::inclusive_scan_single_pass(first, last, d_first, std::plus<>());
+}
+
+/**
+ * Computes the same result as exclusive_scan with `init` and `op` in a single pass
+ */
+template <class _InputIterator, class _OutputIterator, class _Type, class _BinaryOp>
+_OutputIterator exclusive_scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                           _Type init, _BinaryOp op) {
+  return cilkstl::__parallel::__scan_single_pass<false>(first, last, d_first, init, op, ScanIdentity());
+}
+
+/**
+ * Computes the same result as exclusive_scan with `init` and std::plus in a single pass
+ */
+template <class _InputIterator, class _OutputIterator, class _Type>
+_OutputIterator exclusive_scan_single_pass(_InputIterator first, _InputIterator last, _OutputIterator d_first,
+                                           _Type init) {
+  return cilkstl::__parallel::exclusive_scan_single_pass(first, last, d_first, init, std::plus<>());
+}
+
+/**
+ * Segment boundaries given by head flags: element `i` starts a segment when `flags[i]` converts to true. The first
+ * element always starts one.
+ */
+template <class _FlagIterator> struct SegmentHeadFlags {
+  _FlagIterator flags;
+  template <class _DiffType> bool operator()(_DiffType i) const { return i == 0 || bool(flags[i]); }
+};
+
+/**
+ * Segment boundaries given by runs of equal keys: element `i` starts a segment when its key differs from the previous
+ * key under `eq`
+ */
+template <class _KeyIterator, class _KeyEqual> struct SegmentHeadKeys {
+  _KeyIterator keys;
+  _KeyEqual eq;
+  template <class _DiffType> bool operator()(_DiffType i) const { return i == 0 || !eq(keys[i - 1], keys[i]); }
+};
+
+/**
+ * Summary of a block of a segmented range: the number of segments starting in it, and the reduction of the elements
+ * from the last segment head in the block, or from the start of the block if none, to its end
+ */
+template <class _Sum> struct SegmentBlockSummary {
+  std::size_t heads;
+  _Sum tail;
+};
+
+/**
+ * Helper method that summarizes the nonempty block [begin, end) of the range beginning at `first`
+ */
+template <class _Sum, class _InputIterator, class _DiffType, class _HeadFunc, class _BinaryOp>
+SegmentBlockSummary<_Sum> segment_block_reduce(_InputIterator first, _DiffType begin, _DiffType end, _HeadFunc head,
+                                               _BinaryOp op) {
+  std::size_t heads = head(begin) ? 1 : 0;
+  _Sum tail = first[begin];
+  for (_DiffType i = begin + 1; i < end; ++i) {
+    if (head(i)) {
+      ++heads;
+      tail = first[i];
+    } else {
+      tail = op(tail, first[i]);
+    }
+  }
+  return SegmentBlockSummary<_Sum>{heads, tail};
+}
+
+/**
+ * Helper method that scans the summaries of all blocks into the carry-in of every block: the reduction of the elements
+ * of the segment that is open at the start of the block. The carry of the first block is never read.
+ */
+template <class _Sum, class _BinaryOp>
+std::vector<_Sum> segment_carries(const std::vector<SegmentBlockSummary<_Sum>> &summaries, _BinaryOp op) {
+  std::vector<_Sum> carries(summaries.size(), summaries[0].tail);
+  for (std::size_t b = 1; b + 1 < summaries.size(); ++b)
+    carries[b + 1] = summaries[b].heads > 0 ? summaries[b].tail : op(carries[b], summaries[b].tail);
+  return carries;
+}
+
+/**
+ * Helper method that calls `emit(i, sum)` for every element `i` of the nonempty block [begin, end) with the reduction
+ * of the elements from the head of its segment up to and including it. `carry` continues the segment open at the start
+ * of the block unless `begin` is 0.
+ */
+template <class _InputIterator, class _DiffType, class _Sum, class _HeadFunc, class _BinaryOp, class _EmitFunc>
+void segment_block_scan(_InputIterator first, _DiffType begin, _DiffType end, const _Sum &carry, _HeadFunc head,
+                        _BinaryOp op, _EmitFunc emit) {
+  _Sum sum = head(begin) ? _Sum(first[begin]) : op(carry, first[begin]);
+  emit(begin, sum);
+  for (_DiffType i = begin + 1; i < end; ++i) {
+    sum = head(i) ? _Sum(first[i]) : op(sum, first[i]);
+    emit(i, sum);
+  }
+}
+
+/**
+ * Helper method that runs a segmented reduction of [first, last) with segment heads given by `head` with the
+ * reduce-then-scan scheme, calling `emit(i, sum)` for every element in increasing order within each block. The carry
+ * pass fixes up segments that cross block boundaries. `block_emit(heads)` returns the `emit` of a block given the
+ * number of segment heads before it.
+ */
+template <class _Sum, class _InputIterator, class _HeadFunc, class _BinaryOp, class _EmitFactory>
+void __segmented_scan(_InputIterator first, _InputIterator last, _HeadFunc head, _BinaryOp op,
+                      _EmitFactory block_emit) {
+  typedef typename std::iterator_traits<_InputIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  if (range_width == 0)
+    return;
+
+  // Defaults to serial implementation at small range sizes
+  if (range_width < 2 * SCAN_GRAIN || __cilkrts_get_nworkers() == 1) {
+    segment_block_scan(first, (diff_t)0, range_width, _Sum(*first), head, op, block_emit((std::size_t)0));
+    return;
+  }
+
+  diff_t num_blocks = scan_num_blocks(range_width);
+  diff_t block_size = (range_width + num_blocks - 1) / num_blocks;
+
+  std::vector<SegmentBlockSummary<_Sum>> summaries(num_blocks, SegmentBlockSummary<_Sum>{0, _Sum(*first)});
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t begin = b * block_size;
+    diff_t end = std::min(range_width, begin + block_size);
+    if (begin < end)
+      summaries[b] = segment_block_reduce<_Sum>(first, begin, end, head, op);
+  }
+  std::vector<_Sum> carries = segment_carries(summaries, op);
+  std::vector<std::size_t> heads_before(num_blocks, 0);
+  for (diff_t b = 1; b < num_blocks; ++b)
+    heads_before[b] = heads_before[b - 1] + summaries[b - 1].heads;
+
+  cilk_for(diff_t b = 0; b < num_blocks; ++b) {
+    diff_t begin = b * block_size;
+    diff_t end = std::min(range_width, begin + block_size);
+    if (begin < end)
+      segment_block_scan(first, begin, end, carries[b], head, op, block_emit(heads_before[b]));
+  }
+}
+
+/**
+ * Scans every segment of [first, last) independently under `op`: element `i` of the output is the reduction of the
+ * elements from the head of its segment up to and including it. Segment heads are the elements whose flag in the range
+ * beginning at `flags_first` converts to true. Segments may span any number of blocks. `op` must be associative. The
+ * output iterator must support random access and may equal `first`.
+ */
+template <class _InputIterator, class _FlagIterator, class _OutputIterator, class _BinaryOp>
+_OutputIterator segmented_inclusive_scan(_InputIterator first, _InputIterator last, _FlagIterator flags_first,
+                                         _OutputIterator d_first, _BinaryOp op) {
+  typedef typename std::iterator_traits<_InputIterator>::value_type value_t;
+  auto write = [d_first](std::ptrdiff_t i, const value_t &sum) { d_first[i] = sum; };
+  cilkstl::__parallel::__segmented_scan<value_t>(first, last, SegmentHeadFlags<_FlagIterator>{flags_first}, op,
+                                                 [&](std::size_t) { return write; });
+  return d_first + (last - first);
+}
+
+/**
+ * Sums every segment of [first, last) independently, with segment heads given by flags as above
+ */
+template <class _InputIterator, class _FlagIterator, class _OutputIterator>
+_OutputIterator segmented_inclusive_scan(_InputIterator first, _InputIterator last, _FlagIterator flags_first,
+                                         _OutputIterator d_first) {
+  return cilkstl::__parallel::segmented_inclusive_scan(first, last, flags_first, d_first, std::plus<>());
+}
+
+/**
+ * Scans the values beginning at `values_first` independently under `op` over every run of consecutive keys in
+ * [keys_first, keys_last) that are equal under `eq`, as when the keys have been sorted
+ */
+template <class _KeyIterator, class _InputIterator, class _OutputIterator, class _KeyEqual, class _BinaryOp>
+_OutputIterator segmented_inclusive_scan_by_key(_KeyIterator keys_first, _KeyIterator keys_last,
+                                                _InputIterator values_first, _OutputIterator d_first, _KeyEqual eq,
+                                                _BinaryOp op) {
+  typedef typename std::iterator_traits<_InputIterator>::value_type value_t;
+  _InputIterator values_last = values_first + (keys_last - keys_first);
+  auto write = [d_first](std::ptrdiff_t i, const value_t &sum) { d_first[i] = sum; };
+  cilkstl::__parallel::__segmented_scan<value_t>(values_first, values_last,
+                                                 SegmentHeadKeys<_KeyIterator, _KeyEqual>{keys_first, eq}, op,
+                                                 [&](std::size_t) { return write; });
+  return d_first + (keys_last - keys_first);
+}
+
+/**
+ * Sums the values over every run of equal keys, as above
+ */
+template <class _KeyIterator, class _InputIterator, class _OutputIterator>
+_OutputIterator segmented_inclusive_scan_by_key(_KeyIterator keys_first, _KeyIterator keys_last,
+                                                _InputIterator values_first, _OutputIterator d_first) {
+  return cilkstl::__parallel::segmented_inclusive_scan_by_key(keys_first, keys_last, values_first, d_first,
+                                                              std::equal_to<>(), std::plus<>());
+}
+
+/**
+ * Reduces the values beginning at `values_first` under `op` over every run of consecutive keys in
+ * [keys_first, keys_last) that are equal under `eq`, writing the first key of each run to the range beginning at
+ * `keys_out` and its reduction to the range beginning at `values_out`. Runs may span any number of blocks; the block
+ * holding the end of a run writes its result. Returns the ends of both output ranges. Output iterators must support
+ * random access.
+ */
+template <class _KeyIterator, class _InputIterator, class _KeyOutputIterator, class _ValueOutputIterator,
+          class _KeyEqual, class _BinaryOp>
+std::pair<_KeyOutputIterator, _ValueOutputIterator>
+reduce_by_key(_KeyIterator keys_first, _KeyIterator keys_last, _InputIterator values_first,
+              _KeyOutputIterator keys_out, _ValueOutputIterator values_out, _KeyEqual eq, _BinaryOp op) {
+  typedef typename std::iterator_traits<_InputIterator>::value_type value_t;
+  typedef typename std::iterator_traits<_KeyIterator>::difference_type diff_t;
+  diff_t range_width = keys_last - keys_first;
+  SegmentHeadKeys<_KeyIterator, _KeyEqual> head{keys_first, eq};
+
+  // Each block numbers the runs it sees from the count of heads before it; a run ends before the next head
+  std::atomic<std::size_t> num_runs(0);
+  cilkstl::__parallel::__segmented_scan<value_t>(
+      values_first, values_first + range_width, head, op, [&](std::size_t heads_before) {
+        return [&, heads_before](diff_t i, const value_t &sum) mutable {
+          if (head(i))
+            keys_out[heads_before++] = keys_first[i];
+          if (i + 1 == range_width || head(i + 1))
+            values_out[heads_before - 1] = sum;
+          if (i + 1 == range_width)
+            num_runs.store(heads_before, std::memory_order_relaxed);
+        };
+      });
+  std::size_t runs = num_runs.load(std::memory_order_relaxed);
+  return std::make_pair(keys_out + runs, values_out + runs);
+}
+
+/**
+ * Sums the values over every run of equal keys, as above
+ */
+template <class _KeyIterator, class _InputIterator, class _KeyOutputIterator, class _ValueOutputIterator>
+std::pair<_KeyOutputIterator, _ValueOutputIterator> reduce_by_key(_KeyIterator keys_first, _KeyIterator keys_last,
+                                                                  _InputIterator values_first,
+                                                                  _KeyOutputIterator keys_out,
+                                                                  _ValueOutputIterator values_out) {
+  return cilkstl::__parallel::reduce_by_key(keys_first, keys_last, values_first, keys_out, values_out,
+                                            std::equal_to<>(), std::plus<>());
+}
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
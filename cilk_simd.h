@@ -0,0 +1,1006 @@
+#ifndef CILKSTL_SIMD_H
+#define CILKSTL_SIMD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CILKSTL_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cilkstl {
+namespace __parallel {
+
+/**
+ * This file implements SIMD leaf kernels for arithmetic types, selected at runtime between AVX-512, AVX2 and a scalar
+ * fallback. The parallel algorithms call them on blocks of contiguous input when the element type and the predicate are
+ * simple enough to be evaluated several lanes at a time.
+ */
+
+/**
+ * Defines a predicate that compares its argument against a fixed threshold with `_Compare`, for example x < threshold
+ * for std::less. Unlike an arbitrary predicate, it is recognized by the SIMD kernels.
+ */
+template <class _Type, class _Compare> struct ThresholdPredicate {
+  typedef _Compare compare_type;
+  _Type threshold;
+  bool operator()(const _Type &x) const { return _Compare()(x, threshold); }
+};
+
+/**
+ * Returns a predicate that is true for values less than `threshold`
+ */
+template <class _Type> ThresholdPredicate<_Type, std::less<_Type>> less_than(_Type threshold) { return {threshold}; }
+
+/**
+ * Returns a predicate that is true for values greater than `threshold`
+ */
+template <class _Type> ThresholdPredicate<_Type, std::greater<_Type>> greater_than(_Type threshold) {
+  return {threshold};
+}
+
+/**
+ * Returns a predicate that is true for values less than or equal to `threshold`
+ */
+template <class _Type> ThresholdPredicate<_Type, std::less_equal<_Type>> less_or_equal(_Type threshold) {
+  return {threshold};
+}
+
+/**
+ * Returns a predicate that is true for values greater than or equal to `threshold`
+ */
+template <class _Type> ThresholdPredicate<_Type, std::greater_equal<_Type>> greater_or_equal(_Type threshold) {
+  return {threshold};
+}
+
+/**
+ * Instruction set levels the SIMD kernels can run at
+ */
+enum class SimdLevel { SCALAR, AVX2, AVX512 };
+
+/**
+ * Helper method that returns the highest instruction set level supported by the processor
+ */
+inline SimdLevel detected_simd_level() {
+#ifdef CILKSTL_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return SimdLevel::AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::AVX2;
+#endif
+  return SimdLevel::SCALAR;
+}
+
+/**
+ * Returns a reference to the instruction set level used by the SIMD kernels, which defaults to the detected level
+ */
+inline SimdLevel &simd_level() {
+  static SimdLevel level = detected_simd_level();
+  return level;
+}
+
+/**
+ * Sets the instruction set level used by the SIMD kernels, limited to the levels supported by the processor. Mainly
+ * useful to compare the kernels against each other.
+ */
+inline void set_simd_level(SimdLevel level) {
+  SimdLevel detected = detected_simd_level();
+  simd_level() = (int)level < (int)detected ? level : detected;
+}
+
+/**
+ * Defines whether `_Iterator` refers to contiguous storage, so that the address of its first element can be handed to
+ * the SIMD kernels. Holds for pointers and std::vector iterators.
+ */
+template <class _Iterator> struct is_contiguous_iterator {
+  typedef typename std::iterator_traits<_Iterator>::value_type value_t;
+  static constexpr bool value = std::is_pointer<_Iterator>::value ||
+                                (!std::is_same<value_t, bool>::value &&
+                                 (std::is_same<_Iterator, typename std::vector<value_t>::iterator>::value ||
+                                  std::is_same<_Iterator, typename std::vector<value_t>::const_iterator>::value));
+};
+
+namespace __simd {
+
+// Comparison performed by a kernel, as `element OP threshold`
+enum CompareOp { OP_LT, OP_LE, OP_GT, OP_GE };
+
+// Maps the comparator of a ThresholdPredicate to its CompareOp
+template <class _Compare> struct compare_op { static constexpr bool supported = false; };
+template <class _Type> struct compare_op<std::less<_Type>> {
+  static constexpr bool supported = true;
+  static constexpr int value = OP_LT;
+};
+template <class _Type> struct compare_op<std::less_equal<_Type>> {
+  static constexpr bool supported = true;
+  static constexpr int value = OP_LE;
+};
+template <class _Type> struct compare_op<std::greater<_Type>> {
+  static constexpr bool supported = true;
+  static constexpr int value = OP_GT;
+};
+template <class _Type> struct compare_op<std::greater_equal<_Type>> {
+  static constexpr bool supported = true;
+  static constexpr int value = OP_GE;
+};
+
+// Lane layouts handled by the kernels; the 8 and 16-bit layouts are only used by the equality counting kernels
+enum LaneKind { LANES_NONE, LANES_I32, LANES_I64, LANES_F32, LANES_F64, LANES_I8, LANES_I16 };
+
+// Maps an element type to its lane layout
+template <class _Type> struct lane_kind {
+  static constexpr int value =
+      std::is_same<_Type, float>::value    ? LANES_F32
+      : std::is_same<_Type, double>::value ? LANES_F64
+      : (std::is_integral<_Type>::value && std::is_signed<_Type>::value && sizeof(_Type) == 4) ? LANES_I32
+      : (std::is_integral<_Type>::value && std::is_signed<_Type>::value && sizeof(_Type) == 8) ? LANES_I64
+                                                                                               : LANES_NONE;
+};
+
+// Maps an element type to the lane layout of the equality counting kernels, which compare integers bitwise
+template <class _Type> struct equal_lane_kind {
+  static constexpr int value = std::is_floating_point<_Type>::value  ? lane_kind<_Type>::value
+                               : !std::is_integral<_Type>::value     ? LANES_NONE
+                               : std::is_same<_Type, bool>::value    ? LANES_NONE
+                               : sizeof(_Type) == 1                  ? LANES_I8
+                               : sizeof(_Type) == 2                  ? LANES_I16
+                               : sizeof(_Type) == 4                  ? LANES_I32
+                               : sizeof(_Type) == 8                  ? LANES_I64
+                                                                     : LANES_NONE;
+};
+
+// Scalar comparison matching a CompareOp
+template <int _Op, class _Type> inline bool compare(_Type x, _Type threshold) {
+  return _Op == OP_LT ? x < threshold : _Op == OP_LE ? x <= threshold : _Op == OP_GT ? x > threshold : x >= threshold;
+}
+
+/**
+ * Scalar fallback: counts the elements of [in, in + n) satisfying the comparison
+ */
+template <int _Op, class _Type> std::size_t scalar_count(const _Type *in, std::size_t n, _Type threshold) {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    count += compare<_Op>(in[i], threshold);
+  return count;
+}
+
+// Elements written by a split kernel: both classes, only the satisfying elements, or only the others
+enum SplitMode { SPLIT_BOTH, SPLIT_TRUE, SPLIT_FALSE };
+
+/**
+ * Scalar fallback: copies the elements of [in, in + n) in order according to `_Mode`. With SPLIT_BOTH the elements
+ * satisfying the comparison go to `out_true` and the rest to `out_false`; otherwise only the selected class is written,
+ * to `out_true`. Returns the number of elements written to `out_true`.
+ */
+template <int _Mode, int _Op, class _Type>
+std::size_t scalar_split(const _Type *in, std::size_t n, _Type *out_true, _Type *out_false, _Type threshold) {
+  std::size_t num_true = 0, num_false = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    bool satisfied = compare<_Op>(in[i], threshold);
+    if (satisfied != (_Mode == SPLIT_FALSE))
+      out_true[num_true++] = in[i];
+    else if (_Mode == SPLIT_BOTH)
+      out_false[num_false++] = in[i];
+  }
+  return num_true;
+}
+
+/**
+ * Scalar fallback: sets bit `i % 64` of `words[i / 64]` to the result of the comparison on `in[i]` for every element of
+ * [in, in + n). Bits past `n` in the last word are cleared.
+ */
+template <int _Op, class _Type>
+void scalar_bits(const _Type *in, std::size_t n, std::uint64_t *words, _Type threshold) {
+  for (std::size_t w = 0; w * 64 < n; ++w) {
+    std::uint64_t word = 0;
+    for (std::size_t j = 0; j < 64 && w * 64 + j < n; ++j)
+      word |= (std::uint64_t)compare<_Op>(in[w * 64 + j], threshold) << j;
+    words[w] = word;
+  }
+}
+
+/**
+ * Scalar fallback: returns the number of set bits in [words, words + n)
+ */
+inline std::size_t scalar_popcount(const std::uint64_t *words, std::size_t n) {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    count += __builtin_popcountll(words[i]);
+  return count;
+}
+
+#ifdef CILKSTL_SIMD_X86
+
+#define CILKSTL_AVX2 __attribute__((target("avx2,popcnt")))
+#define CILKSTL_AVX512 __attribute__((target("avx512f,popcnt")))
+
+// Immediate operands of the AVX-512 integer comparisons and the AVX floating point comparisons for a CompareOp
+constexpr int int_compare_imm(int op) {
+  return op == OP_LT ? _MM_CMPINT_LT : op == OP_LE ? _MM_CMPINT_LE : op == OP_GT ? _MM_CMPINT_NLE : _MM_CMPINT_NLT;
+}
+constexpr int fp_compare_imm(int op) {
+  return op == OP_LT ? _CMP_LT_OQ : op == OP_LE ? _CMP_LE_OQ : op == OP_GT ? _CMP_GT_OQ : _CMP_GE_OQ;
+}
+
+/**
+ * Tables for compressing the lanes of an AVX2 register: `permute[m]` moves the 32-bit lanes selected by the mask `m` to
+ * the front, and `prefix[c]` enables the first `c` lanes of a masked store.
+ */
+struct Avx2CompressTables {
+  alignas(32) std::int32_t permute[256][8];
+  alignas(32) std::int32_t prefix[9][8];
+
+  Avx2CompressTables() {
+    for (int m = 0; m < 256; ++m) {
+      int k = 0;
+      for (int i = 0; i < 8; ++i) {
+        if ((m >> i) & 1)
+          permute[m][k++] = i;
+      }
+      while (k < 8)
+        permute[m][k++] = 0;
+    }
+    for (int c = 0; c <= 8; ++c) {
+      for (int i = 0; i < 8; ++i)
+        prefix[c][i] = (i < c) ? -1 : 0;
+    }
+  }
+};
+
+inline const Avx2CompressTables &avx2_compress_tables() {
+  static const Avx2CompressTables tables;
+  return tables;
+}
+
+// Spreads a 4-bit mask over 64-bit lanes into the equivalent 8-bit mask over 32-bit lanes
+inline unsigned spread_mask4(unsigned m) { return ((m & 1) * 3) | ((m & 2) * 6) | ((m & 4) * 12) | ((m & 8) * 24); }
+
+/**
+ * AVX2 lane operations for each lane layout: `compare` returns the comparison results of one register as a bit mask,
+ * and `compress` stores the lanes selected by a mask contiguously at `out` without writing past them.
+ */
+template <int _Kind> struct Avx2Ops;
+
+template <> struct Avx2Ops<LANES_I32> {
+  typedef std::int32_t type;
+  static constexpr int lanes = 8;
+  template <int _Op> CILKSTL_AVX2 static unsigned compare(const type *in, __m256i t) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)in);
+    __m256i r = (_Op == OP_LT || _Op == OP_GE) ? _mm256_cmpgt_epi32(t, v) : _mm256_cmpgt_epi32(v, t);
+    unsigned m = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(r));
+    return (_Op == OP_LE || _Op == OP_GE) ? m ^ 0xFFu : m;
+  }
+  CILKSTL_AVX2 static __m256i splat(type x) { return _mm256_set1_epi32(x); }
+  CILKSTL_AVX2 static void compress(type *out, const type *in, unsigned m, const Avx2CompressTables &tables) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)in);
+    __m256i perm = _mm256_load_si256((const __m256i *)tables.permute[m]);
+    __m256i store = _mm256_load_si256((const __m256i *)tables.prefix[_mm_popcnt_u32(m)]);
+    _mm256_maskstore_epi32((int *)out, store, _mm256_permutevar8x32_epi32(v, perm));
+  }
+};
+
+template <> struct Avx2Ops<LANES_F32> {
+  typedef float type;
+  static constexpr int lanes = 8;
+  template <int _Op> CILKSTL_AVX2 static unsigned compare(const type *in, __m256 t) {
+    return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(in), t, fp_compare_imm(_Op)));
+  }
+  CILKSTL_AVX2 static __m256 splat(type x) { return _mm256_set1_ps(x); }
+  CILKSTL_AVX2 static void compress(type *out, const type *in, unsigned m, const Avx2CompressTables &tables) {
+    Avx2Ops<LANES_I32>::compress((std::int32_t *)out, (const std::int32_t *)in, m, tables);
+  }
+};
+
+template <> struct Avx2Ops<LANES_I64> {
+  typedef std::int64_t type;
+  static constexpr int lanes = 4;
+  template <int _Op> CILKSTL_AVX2 static unsigned compare(const type *in, __m256i t) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)in);
+    __m256i r = (_Op == OP_LT || _Op == OP_GE) ? _mm256_cmpgt_epi64(t, v) : _mm256_cmpgt_epi64(v, t);
+    unsigned m = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(r));
+    return (_Op == OP_LE || _Op == OP_GE) ? m ^ 0xFu : m;
+  }
+  CILKSTL_AVX2 static __m256i splat(type x) { return _mm256_set1_epi64x(x); }
+  CILKSTL_AVX2 static void compress(type *out, const type *in, unsigned m, const Avx2CompressTables &tables) {
+    Avx2Ops<LANES_I32>::compress((std::int32_t *)out, (const std::int32_t *)in, spread_mask4(m), tables);
+  }
+};
+
+template <> struct Avx2Ops<LANES_F64> {
+  typedef double type;
+  static constexpr int lanes = 4;
+  template <int _Op> CILKSTL_AVX2 static unsigned compare(const type *in, __m256d t) {
+    return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(in), t, fp_compare_imm(_Op)));
+  }
+  CILKSTL_AVX2 static __m256d splat(type x) { return _mm256_set1_pd(x); }
+  CILKSTL_AVX2 static void compress(type *out, const type *in, unsigned m, const Avx2CompressTables &tables) {
+    Avx2Ops<LANES_I32>::compress((std::int32_t *)out, (const std::int32_t *)in, spread_mask4(m), tables);
+  }
+};
+
+/**
+ * AVX-512 lane operations for each lane layout, with the same roles as in Avx2Ops. Compression goes through a register
+ * followed by a masked store, which is faster than a compressing store on several processors.
+ */
+template <int _Kind> struct Avx512Ops;
+
+template <> struct Avx512Ops<LANES_I32> {
+  typedef std::int32_t type;
+  static constexpr int lanes = 16;
+  template <int _Op> CILKSTL_AVX512 static unsigned compare(const type *in, __m512i t) {
+    return _mm512_cmp_epi32_mask(_mm512_loadu_si512(in), t, int_compare_imm(_Op));
+  }
+  CILKSTL_AVX512 static __m512i splat(type x) { return _mm512_set1_epi32(x); }
+  CILKSTL_AVX512 static void compress(type *out, const type *in, unsigned m) {
+    __m512i v = _mm512_maskz_compress_epi32((__mmask16)m, _mm512_loadu_si512(in));
+    _mm512_mask_storeu_epi32(out, (__mmask16)((1u << _mm_popcnt_u32(m)) - 1), v);
+  }
+};
+
+template <> struct Avx512Ops<LANES_F32> {
+  typedef float type;
+  static constexpr int lanes = 16;
+  template <int _Op> CILKSTL_AVX512 static unsigned compare(const type *in, __m512 t) {
+    return _mm512_cmp_ps_mask(_mm512_loadu_ps(in), t, fp_compare_imm(_Op));
+  }
+  CILKSTL_AVX512 static __m512 splat(type x) { return _mm512_set1_ps(x); }
+  CILKSTL_AVX512 static void compress(type *out, const type *in, unsigned m) {
+    Avx512Ops<LANES_I32>::compress((std::int32_t *)out, (const std::int32_t *)in, m);
+  }
+};
+
+template <> struct Avx512Ops<LANES_I64> {
+  typedef std::int64_t type;
+  static constexpr int lanes = 8;
+  template <int _Op> CILKSTL_AVX512 static unsigned compare(const type *in, __m512i t) {
+    return _mm512_cmp_epi64_mask(_mm512_loadu_si512(in), t, int_compare_imm(_Op));
+  }
+  CILKSTL_AVX512 static __m512i splat(type x) { return _mm512_set1_epi64(x); }
+  CILKSTL_AVX512 static void compress(type *out, const type *in, unsigned m) {
+    __m512i v = _mm512_maskz_compress_epi64((__mmask8)m, _mm512_loadu_si512(in));
+    _mm512_mask_storeu_epi64(out, (__mmask8)((1u << _mm_popcnt_u32(m)) - 1), v);
+  }
+};
+
+template <> struct Avx512Ops<LANES_F64> {
+  typedef double type;
+  static constexpr int lanes = 8;
+  template <int _Op> CILKSTL_AVX512 static unsigned compare(const type *in, __m512d t) {
+    return _mm512_cmp_pd_mask(_mm512_loadu_pd(in), t, fp_compare_imm(_Op));
+  }
+  CILKSTL_AVX512 static __m512d splat(type x) { return _mm512_set1_pd(x); }
+  CILKSTL_AVX512 static void compress(type *out, const type *in, unsigned m) {
+    Avx512Ops<LANES_I64>::compress((std::int64_t *)out, (const std::int64_t *)in, m);
+  }
+};
+
+template <int _Kind, int _Op>
+CILKSTL_AVX2 std::size_t avx2_count(const typename Avx2Ops<_Kind>::type *in, std::size_t n,
+                                    typename Avx2Ops<_Kind>::type threshold) {
+  typedef Avx2Ops<_Kind> ops;
+  auto t = ops::splat(threshold);
+  std::size_t count = 0, i = 0;
+  for (; i + ops::lanes <= n; i += ops::lanes)
+    count += _mm_popcnt_u32(ops::template compare<_Op>(in + i, t));
+  return count + scalar_count<_Op>(in + i, n - i, threshold);
+}
+
+template <int _Mode, int _Kind, int _Op>
+CILKSTL_AVX2 std::size_t avx2_split(const typename Avx2Ops<_Kind>::type *in, std::size_t n,
+                                    typename Avx2Ops<_Kind>::type *out_true, typename Avx2Ops<_Kind>::type *out_false,
+                                    typename Avx2Ops<_Kind>::type threshold) {
+  typedef Avx2Ops<_Kind> ops;
+  const Avx2CompressTables &tables = avx2_compress_tables();
+  const unsigned all = (1u << ops::lanes) - 1;
+  auto t = ops::splat(threshold);
+  std::size_t num_true = 0, num_false = 0, i = 0;
+  for (; i + ops::lanes <= n; i += ops::lanes) {
+    unsigned m = ops::template compare<_Op>(in + i, t) ^ (_Mode == SPLIT_FALSE ? all : 0u);
+    ops::compress(out_true + num_true, in + i, m, tables);
+    num_true += _mm_popcnt_u32(m);
+    if (_Mode == SPLIT_BOTH) {
+      ops::compress(out_false + num_false, in + i, m ^ all, tables);
+      num_false += ops::lanes - _mm_popcnt_u32(m);
+    }
+  }
+  return num_true + scalar_split<_Mode, _Op>(in + i, n - i, out_true + num_true, out_false + num_false, threshold);
+}
+
+template <int _Kind, int _Op>
+CILKSTL_AVX512 std::size_t avx512_count(const typename Avx512Ops<_Kind>::type *in, std::size_t n,
+                                        typename Avx512Ops<_Kind>::type threshold) {
+  typedef Avx512Ops<_Kind> ops;
+  auto t = ops::splat(threshold);
+  std::size_t count = 0, i = 0;
+  for (; i + ops::lanes <= n; i += ops::lanes)
+    count += _mm_popcnt_u32(ops::template compare<_Op>(in + i, t));
+  return count + scalar_count<_Op>(in + i, n - i, threshold);
+}
+
+template <int _Mode, int _Kind, int _Op>
+CILKSTL_AVX512 std::size_t avx512_split(const typename Avx512Ops<_Kind>::type *in, std::size_t n,
+                                        typename Avx512Ops<_Kind>::type *out_true,
+                                        typename Avx512Ops<_Kind>::type *out_false,
+                                        typename Avx512Ops<_Kind>::type threshold) {
+  typedef Avx512Ops<_Kind> ops;
+  const unsigned all = (1u << ops::lanes) - 1;
+  auto t = ops::splat(threshold);
+  std::size_t num_true = 0, num_false = 0, i = 0;
+  for (; i + ops::lanes <= n; i += ops::lanes) {
+    unsigned m = ops::template compare<_Op>(in + i, t) ^ (_Mode == SPLIT_FALSE ? all : 0u);
+    ops::compress(out_true + num_true, in + i, m);
+    num_true += _mm_popcnt_u32(m);
+    if (_Mode == SPLIT_BOTH) {
+      ops::compress(out_false + num_false, in + i, m ^ all);
+      num_false += ops::lanes - _mm_popcnt_u32(m);
+    }
+  }
+  return num_true + scalar_split<_Mode, _Op>(in + i, n - i, out_true + num_true, out_false + num_false, threshold);
+}
+
+template <int _Kind, int _Op>
+CILKSTL_AVX2 void avx2_bits(const typename Avx2Ops<_Kind>::type *in, std::size_t n, std::uint64_t *words,
+                            typename Avx2Ops<_Kind>::type threshold) {
+  typedef Avx2Ops<_Kind> ops;
+  auto t = ops::splat(threshold);
+  std::size_t w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    std::uint64_t word = 0;
+    for (int j = 0; j < 64; j += ops::lanes)
+      word |= (std::uint64_t)ops::template compare<_Op>(in + w * 64 + j, t) << j;
+    words[w] = word;
+  }
+  scalar_bits<_Op>(in + w * 64, n - w * 64, words + w, threshold);
+}
+
+template <int _Kind, int _Op>
+CILKSTL_AVX512 void avx512_bits(const typename Avx512Ops<_Kind>::type *in, std::size_t n, std::uint64_t *words,
+                                typename Avx512Ops<_Kind>::type threshold) {
+  typedef Avx512Ops<_Kind> ops;
+  auto t = ops::splat(threshold);
+  std::size_t w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    std::uint64_t word = 0;
+    for (int j = 0; j < 64; j += ops::lanes)
+      word |= (std::uint64_t)ops::template compare<_Op>(in + w * 64 + j, t) << j;
+    words[w] = word;
+  }
+  scalar_bits<_Op>(in + w * 64, n - w * 64, words + w, threshold);
+}
+
+/**
+ * Counts the set bits of [words, words + n) with the nibble lookup method: every byte is split into two nibbles whose
+ * bit counts are looked up with a byte shuffle, and the byte counts are summed into 64-bit lanes with vpsadbw
+ */
+CILKSTL_AVX2 inline std::size_t avx2_popcount(const std::uint64_t *words, std::size_t n) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                          2, 3, 2, 3, 3, 4);
+  const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+  __m256i sums = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(words + i));
+    __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibbles));
+    __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles));
+    sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  std::size_t count = (std::size_t)(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                                    _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+  for (; i < n; ++i)
+    count += _mm_popcnt_u64(words[i]);
+  return count;
+}
+
+/**
+ * Scans 64-bit integers four lanes at a time with two shift-and-add steps, adding the running total `carry` to each
+ * group. The total of each group is broadcast from the local scan, so the loop-carried dependency is one addition per
+ * group. In-place operation is allowed.
+ */
+template <bool _Inclusive>
+CILKSTL_AVX2 std::uint64_t avx2_scan_add64(const std::uint64_t *in, std::size_t n, std::uint64_t *out,
+                                           std::uint64_t carry) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i c = _mm256_set1_epi64x((long long)carry);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i v = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x93), zero, 0x03));
+    v = _mm256_add_epi64(v, _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x4E), zero, 0x0F));
+    __m256i result = _mm256_add_epi64(c, _Inclusive ? v : _mm256_sub_epi64(v, x));
+    c = _mm256_add_epi64(c, _mm256_permute4x64_epi64(v, 0xFF));
+    _mm256_storeu_si256((__m256i *)(out + i), result);
+  }
+  carry = (std::uint64_t)_mm256_extract_epi64(c, 0);
+  for (; i < n; ++i) {
+    std::uint64_t x = in[i];
+    out[i] = _Inclusive ? carry + x : carry;
+    carry += x;
+  }
+  return carry;
+}
+
+/**
+ * Scans 32-bit integers eight lanes at a time: two byte shifts scan each 128-bit half, and the total of the low half is
+ * then added to the high half. Otherwise as avx2_scan_add64.
+ */
+template <bool _Inclusive>
+CILKSTL_AVX2 std::uint32_t avx2_scan_add32(const std::uint32_t *in, std::size_t n, std::uint32_t *out,
+                                           std::uint32_t carry) {
+  const __m256i last_lane = _mm256_set1_epi32(7);
+  __m256i c = _mm256_set1_epi32((int)carry);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i v = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    __m256i half_totals = _mm256_shuffle_epi32(v, 0xFF);
+    v = _mm256_add_epi32(v, _mm256_permute2x128_si256(half_totals, half_totals, 0x08));
+    __m256i result = _mm256_add_epi32(c, _Inclusive ? v : _mm256_sub_epi32(v, x));
+    c = _mm256_add_epi32(c, _mm256_permutevar8x32_epi32(v, last_lane));
+    _mm256_storeu_si256((__m256i *)(out + i), result);
+  }
+  carry = (std::uint32_t)_mm256_extract_epi32(c, 0);
+  for (; i < n; ++i) {
+    std::uint32_t x = in[i];
+    out[i] = _Inclusive ? carry + x : carry;
+    carry += x;
+  }
+  return carry;
+}
+
+/**
+ * Sums 32 or 64-bit integers with four independent vector accumulators
+ */
+template <class _Lane> CILKSTL_AVX2 _Lane avx2_reduce_add(const _Lane *in, std::size_t n) {
+  constexpr std::size_t lanes = 32 / sizeof(_Lane);
+  __m256i sums[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+  std::size_t i = 0;
+  for (; i + 4 * lanes <= n; i += 4 * lanes) {
+    for (int k = 0; k < 4; ++k) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(in + i + k * lanes));
+      sums[k] = (sizeof(_Lane) == 8) ? _mm256_add_epi64(sums[k], x) : _mm256_add_epi32(sums[k], x);
+    }
+  }
+  alignas(32) _Lane partial[lanes];
+  _mm256_store_si256((__m256i *)partial, (sizeof(_Lane) == 8)
+                                             ? _mm256_add_epi64(_mm256_add_epi64(sums[0], sums[1]),
+                                                                _mm256_add_epi64(sums[2], sums[3]))
+                                             : _mm256_add_epi32(_mm256_add_epi32(sums[0], sums[1]),
+                                                                _mm256_add_epi32(sums[2], sums[3])));
+  _Lane total = 0;
+  for (std::size_t k = 0; k < lanes; ++k)
+    total += partial[k];
+  for (; i < n; ++i)
+    total += in[i];
+  return total;
+}
+
+/**
+ * Counts the bytes of [in, in + n) equal to `value` in the style of memchr-count: every matching byte subtracts -1 from
+ * a byte lane counter, and the counters are flushed into 64-bit totals with vpsadbw before any of them can overflow
+ */
+CILKSTL_AVX2 inline std::size_t avx2_count_equal8(const std::uint8_t *in, std::size_t n, std::uint8_t value) {
+  const __m256i needle = _mm256_set1_epi8((char)value);
+  __m256i totals = _mm256_setzero_si256();
+  std::size_t i = 0;
+  while (i + 32 <= n) {
+    std::size_t rounds = std::min((n - i) / 32, (std::size_t)255);
+    __m256i counters = _mm256_setzero_si256();
+    for (std::size_t r = 0; r < rounds; ++r, i += 32)
+      counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(in + i)), needle));
+    totals = _mm256_add_epi64(totals, _mm256_sad_epu8(counters, _mm256_setzero_si256()));
+  }
+  std::size_t count = (std::size_t)(_mm256_extract_epi64(totals, 0) + _mm256_extract_epi64(totals, 1) +
+                                    _mm256_extract_epi64(totals, 2) + _mm256_extract_epi64(totals, 3));
+  for (; i < n; ++i)
+    count += in[i] == value;
+  return count;
+}
+
+/**
+ * Counts the 16-bit elements of [in, in + n) equal to `value`: the comparison results of two registers are packed into
+ * one register of byte masks, whose lane order does not matter for counting, and accumulated as in avx2_count_equal8
+ */
+CILKSTL_AVX2 inline std::size_t avx2_count_equal16(const std::uint16_t *in, std::size_t n, std::uint16_t value) {
+  const __m256i needle = _mm256_set1_epi16((short)value);
+  __m256i totals = _mm256_setzero_si256();
+  std::size_t i = 0;
+  while (i + 32 <= n) {
+    std::size_t rounds = std::min((n - i) / 32, (std::size_t)255);
+    __m256i counters = _mm256_setzero_si256();
+    for (std::size_t r = 0; r < rounds; ++r, i += 32) {
+      __m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(in + i)), needle);
+      __m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(in + i + 16)), needle);
+      counters = _mm256_sub_epi8(counters, _mm256_packs_epi16(lo, hi));
+    }
+    totals = _mm256_add_epi64(totals, _mm256_sad_epu8(counters, _mm256_setzero_si256()));
+  }
+  std::size_t count = (std::size_t)(_mm256_extract_epi64(totals, 0) + _mm256_extract_epi64(totals, 1) +
+                                    _mm256_extract_epi64(totals, 2) + _mm256_extract_epi64(totals, 3));
+  for (; i < n; ++i)
+    count += in[i] == value;
+  return count;
+}
+
+// Equality masks of one register of 32 or 64-bit lanes; floating point lanes compare as numbers, not bitwise
+CILKSTL_AVX2 inline unsigned avx2_equal_mask(const std::int32_t *in, __m256i needle) {
+  __m256i r = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)in), needle);
+  return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(r));
+}
+CILKSTL_AVX2 inline unsigned avx2_equal_mask(const std::int64_t *in, __m256i needle) {
+  __m256i r = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)in), needle);
+  return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(r));
+}
+CILKSTL_AVX2 inline unsigned avx2_equal_mask(const float *in, __m256 needle) {
+  return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(in), needle, _CMP_EQ_OQ));
+}
+CILKSTL_AVX2 inline unsigned avx2_equal_mask(const double *in, __m256d needle) {
+  return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(in), needle, _CMP_EQ_OQ));
+}
+
+/**
+ * Counts the 32 or 64-bit elements of [in, in + n) equal to `value` with a compare, movemask and popcount per register
+ */
+template <int _Kind>
+CILKSTL_AVX2 std::size_t avx2_count_equal(const typename Avx2Ops<_Kind>::type *in, std::size_t n,
+                                          typename Avx2Ops<_Kind>::type value) {
+  typedef Avx2Ops<_Kind> ops;
+  auto needle = ops::splat(value);
+  std::size_t count = 0, i = 0;
+  for (; i + ops::lanes <= n; i += ops::lanes)
+    count += _mm_popcnt_u32(avx2_equal_mask(in + i, needle));
+  for (; i < n; ++i)
+    count += in[i] == value;
+  return count;
+}
+
+/**
+ * AVX2 lane operations of the arg-min and arg-max kernels, on values held in integer registers: `greater` returns the
+ * lanes where `a` is greater than `b` as a full lane mask, `unordered` the NaN lanes, and the index operations keep one
+ * element index per lane in integers as wide as the lane.
+ */
+template <int _Kind> struct Avx2ExtremumOps;
+
+template <> struct Avx2ExtremumOps<LANES_I32> {
+  typedef std::int32_t type;
+  typedef std::int32_t index_type;
+  static constexpr int lanes = 8;
+  CILKSTL_AVX2 static __m256i greater(__m256i a, __m256i b) { return _mm256_cmpgt_epi32(a, b); }
+  CILKSTL_AVX2 static __m256i unordered(__m256i) { return _mm256_setzero_si256(); }
+  CILKSTL_AVX2 static __m256i first_indices() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+  CILKSTL_AVX2 static __m256i add_indices(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+  CILKSTL_AVX2 static __m256i splat_index(index_type x) { return _mm256_set1_epi32(x); }
+};
+
+template <> struct Avx2ExtremumOps<LANES_F32> : Avx2ExtremumOps<LANES_I32> {
+  typedef float type;
+  CILKSTL_AVX2 static __m256i greater(__m256i a, __m256i b) {
+    return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_GT_OQ));
+  }
+  CILKSTL_AVX2 static __m256i unordered(__m256i a) {
+    return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(a), _CMP_UNORD_Q));
+  }
+};
+
+template <> struct Avx2ExtremumOps<LANES_I64> {
+  typedef std::int64_t type;
+  typedef std::int64_t index_type;
+  static constexpr int lanes = 4;
+  CILKSTL_AVX2 static __m256i greater(__m256i a, __m256i b) { return _mm256_cmpgt_epi64(a, b); }
+  CILKSTL_AVX2 static __m256i unordered(__m256i) { return _mm256_setzero_si256(); }
+  CILKSTL_AVX2 static __m256i first_indices() { return _mm256_setr_epi64x(0, 1, 2, 3); }
+  CILKSTL_AVX2 static __m256i add_indices(__m256i a, __m256i b) { return _mm256_add_epi64(a, b); }
+  CILKSTL_AVX2 static __m256i splat_index(index_type x) { return _mm256_set1_epi64x(x); }
+};
+
+template <> struct Avx2ExtremumOps<LANES_F64> : Avx2ExtremumOps<LANES_I64> {
+  typedef double type;
+  CILKSTL_AVX2 static __m256i greater(__m256i a, __m256i b) {
+    return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_GT_OQ));
+  }
+  CILKSTL_AVX2 static __m256i unordered(__m256i a) {
+    return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(a), _CMP_UNORD_Q));
+  }
+};
+
+/**
+ * Returns the index of the first largest element of the nonempty range [in, in + n) if `_Max` is true, or of the first
+ * smallest one otherwise. Every lane keeps its running extremum and the index it was found at, replacing them only on
+ * a strictly better element, and the lanes are reduced at the end with ties going to the lower index. Sets `unordered`
+ * if the range holds a NaN, in which case the result must be discarded. Requires n < 2^31.
+ */
+template <bool _Max, int _Kind>
+CILKSTL_AVX2 std::size_t avx2_arg_extremum(const typename Avx2ExtremumOps<_Kind>::type *in, std::size_t n,
+                                           bool &unordered) {
+  typedef Avx2ExtremumOps<_Kind> ops;
+  typedef typename ops::type type;
+  typedef typename ops::index_type index_t;
+  constexpr std::size_t lanes = ops::lanes;
+
+  std::size_t best = 0, i = 1;
+  unordered = in[0] != in[0];
+  if (n >= 2 * lanes) {
+    __m256i values = _mm256_loadu_si256((const __m256i *)in);
+    __m256i indices = ops::first_indices();
+    __m256i current = indices;
+    __m256i step = ops::splat_index((index_t)lanes);
+    __m256i nans = ops::unordered(values);
+    for (i = lanes; i + lanes <= n; i += lanes) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+      current = ops::add_indices(current, step);
+      __m256i better = _Max ? ops::greater(x, values) : ops::greater(values, x);
+      values = _mm256_blendv_epi8(values, x, better);
+      indices = _mm256_blendv_epi8(indices, current, better);
+      nans = _mm256_or_si256(nans, ops::unordered(x));
+    }
+    unordered = !_mm256_testz_si256(nans, nans);
+
+    alignas(32) type lane_values[lanes];
+    alignas(32) index_t lane_indices[lanes];
+    _mm256_store_si256((__m256i *)lane_values, values);
+    _mm256_store_si256((__m256i *)lane_indices, indices);
+    best = (std::size_t)lane_indices[0];
+    for (std::size_t k = 1; k < lanes; ++k) {
+      type x = lane_values[k], y = in[best];
+      bool better = _Max ? y < x : x < y;
+      bool worse = _Max ? x < y : y < x;
+      if (better || (!worse && (std::size_t)lane_indices[k] < best))
+        best = (std::size_t)lane_indices[k];
+    }
+  }
+  for (; i < n; ++i) {
+    if (_Max ? in[best] < in[i] : in[i] < in[best])
+      best = i;
+    unordered = unordered || in[i] != in[i];
+  }
+  return best;
+}
+
+#endif // CILKSTL_SIMD_X86
+
+/**
+ * Helper that dispatches the counting, splitting and bitmap kernels for element type `_Type` and comparison `_Op` to
+ * the highest available instruction set level
+ */
+template <class _Type, int _Op> struct ThresholdKernels {
+  static constexpr int kind = lane_kind<_Type>::value;
+
+#ifdef CILKSTL_SIMD_X86
+  typedef typename Avx2Ops<kind>::type lane_t;
+#endif
+
+  static std::size_t count(const _Type *in, std::size_t n, _Type threshold) {
+#ifdef CILKSTL_SIMD_X86
+    if (simd_level() == SimdLevel::AVX512)
+      return avx512_count<kind, _Op>((const lane_t *)in, n, (lane_t)threshold);
+    if (simd_level() == SimdLevel::AVX2)
+      return avx2_count<kind, _Op>((const lane_t *)in, n, (lane_t)threshold);
+#endif
+    return scalar_count<_Op>(in, n, threshold);
+  }
+
+  template <int _Mode>
+  static std::size_t split(const _Type *in, std::size_t n, _Type *out_true, _Type *out_false, _Type threshold) {
+#ifdef CILKSTL_SIMD_X86
+    if (simd_level() == SimdLevel::AVX512)
+      return avx512_split<_Mode, kind, _Op>((const lane_t *)in, n, (lane_t *)out_true, (lane_t *)out_false,
+                                             (lane_t)threshold);
+    if (simd_level() == SimdLevel::AVX2)
+      return avx2_split<_Mode, kind, _Op>((const lane_t *)in, n, (lane_t *)out_true, (lane_t *)out_false,
+                                           (lane_t)threshold);
+#endif
+    return scalar_split<_Mode, _Op>(in, n, out_true, out_false, threshold);
+  }
+
+  static void bits(const _Type *in, std::size_t n, std::uint64_t *words, _Type threshold) {
+#ifdef CILKSTL_SIMD_X86
+    if (simd_level() == SimdLevel::AVX512)
+      return avx512_bits<kind, _Op>((const lane_t *)in, n, words, (lane_t)threshold);
+    if (simd_level() == SimdLevel::AVX2)
+      return avx2_bits<kind, _Op>((const lane_t *)in, n, words, (lane_t)threshold);
+#endif
+    scalar_bits<_Op>(in, n, words, threshold);
+  }
+};
+
+} // namespace __simd
+
+/**
+ * Defines whether the SIMD kernels can evaluate the predicate `_PredicateFunc` on elements of `_Type`: the predicate
+ * must be a ThresholdPredicate with one of the standard comparisons, and `_Type` must be float, double or a signed 32
+ * or 64 bit integer.
+ */
+template <class _Type, class _PredicateFunc> struct simd_predicate {
+  static constexpr bool value = false;
+};
+template <class _Type, class _Compare> struct simd_predicate<_Type, ThresholdPredicate<_Type, _Compare>> {
+  static constexpr bool value =
+      __simd::compare_op<_Compare>::supported && __simd::lane_kind<_Type>::value != __simd::LANES_NONE;
+};
+
+/**
+ * Helper method: returns the number of elements of [in, in + n) satisfying the threshold predicate `p`, using the SIMD
+ * kernels. Requires simd_predicate<_Type, _PredicateFunc>.
+ */
+template <class _Type, class _PredicateFunc>
+std::size_t simd_count_if(const _Type *in, std::size_t n, _PredicateFunc p) {
+  typedef typename _PredicateFunc::compare_type compare_t;
+  return __simd::ThresholdKernels<_Type, __simd::compare_op<compare_t>::value>::count(in, n, p.threshold);
+}
+
+/**
+ * Helper method: copies the elements of [in, in + n) satisfying the threshold predicate `p` to `out_true` and the rest
+ * to `out_false`, preserving their order, using the SIMD kernels. Returns the number of satisfying elements. Nothing is
+ * written past the copied elements. Requires simd_predicate<_Type, _PredicateFunc>.
+ */
+template <class _Type, class _PredicateFunc>
+std::size_t simd_split(const _Type *in, std::size_t n, _Type *out_true, _Type *out_false, _PredicateFunc p) {
+  typedef typename _PredicateFunc::compare_type compare_t;
+  return __simd::ThresholdKernels<_Type, __simd::compare_op<compare_t>::value>::template split<__simd::SPLIT_BOTH>(
+      in, n, out_true, out_false, p.threshold);
+}
+
+/**
+ * Helper method: copies the elements of [in, in + n) satisfying the threshold predicate `p` to `out`, preserving their
+ * order, using the SIMD kernels. Returns the number of copied elements. Nothing is written past the copied elements.
+ * Requires simd_predicate<_Type, _PredicateFunc>.
+ */
+template <class _Type, class _PredicateFunc>
+std::size_t simd_compress(const _Type *in, std::size_t n, _Type *out, _PredicateFunc p) {
+  typedef typename _PredicateFunc::compare_type compare_t;
+  return __simd::ThresholdKernels<_Type, __simd::compare_op<compare_t>::value>::template split<__simd::SPLIT_TRUE>(
+      in, n, out, out, p.threshold);
+}
+
+/**
+ * Helper method: copies the elements of [in, in + n) that do not satisfy the threshold predicate `p` to `out`,
+ * preserving their order, using the SIMD kernels. Returns the number of copied elements. Nothing is written past the
+ * copied elements. Requires simd_predicate<_Type, _PredicateFunc>.
+ */
+template <class _Type, class _PredicateFunc>
+std::size_t simd_compress_not(const _Type *in, std::size_t n, _Type *out, _PredicateFunc p) {
+  typedef typename _PredicateFunc::compare_type compare_t;
+  return __simd::ThresholdKernels<_Type, __simd::compare_op<compare_t>::value>::template split<__simd::SPLIT_FALSE>(
+      in, n, out, out, p.threshold);
+}
+
+/**
+ * Helper method: sets bit `i % 64` of `words[i / 64]` to the result of the threshold predicate `p` on `in[i]` for every
+ * element of [in, in + n), using the SIMD kernels. Bits past `n` in the last word are cleared. Requires
+ * simd_predicate<_Type, _PredicateFunc>.
+ */
+template <class _Type, class _PredicateFunc>
+void simd_predicate_bits(const _Type *in, std::size_t n, std::uint64_t *words, _PredicateFunc p) {
+  typedef typename _PredicateFunc::compare_type compare_t;
+  __simd::ThresholdKernels<_Type, __simd::compare_op<compare_t>::value>::bits(in, n, words, p.threshold);
+}
+
+/**
+ * Helper method: returns the number of set bits in [words, words + n), using the AVX2 kernel when available
+ */
+inline std::size_t simd_popcount(const std::uint64_t *words, std::size_t n) {
+#ifdef CILKSTL_SIMD_X86
+  if (simd_level() != SimdLevel::SCALAR)
+    return __simd::avx2_popcount(words, n);
+#endif
+  return __simd::scalar_popcount(words, n);
+}
+
+/**
+ * Defines whether the SIMD scan and reduction kernels can add elements of `_Type`, which must be a 32 or 64-bit integer
+ */
+template <class _Type> struct simd_add_type {
+  static constexpr bool value = std::is_integral<_Type>::value && !std::is_same<_Type, bool>::value &&
+                                (sizeof(_Type) == 4 || sizeof(_Type) == 8);
+};
+
+/**
+ * Helper method: writes the inclusive (or, if `_Inclusive` is false, exclusive) prefix sums of [in, in + n) offset by
+ * `carry` to [out, out + n) and returns `carry` plus the sum of the range. Additions wrap around. `out` may equal `in`.
+ * Requires simd_add_type<_Type>.
+ */
+template <bool _Inclusive, class _Type> _Type simd_scan_add(const _Type *in, std::size_t n, _Type *out, _Type carry) {
+#ifdef CILKSTL_SIMD_X86
+  if (simd_level() != SimdLevel::SCALAR) {
+    if (sizeof(_Type) == 8)
+      return (_Type)__simd::avx2_scan_add64<_Inclusive>((const std::uint64_t *)in, n, (std::uint64_t *)out,
+                                                        (std::uint64_t)carry);
+    return (_Type)__simd::avx2_scan_add32<_Inclusive>((const std::uint32_t *)in, n, (std::uint32_t *)out,
+                                                      (std::uint32_t)carry);
+  }
+#endif
+  typedef typename std::make_unsigned<_Type>::type lane_t;
+  lane_t sum = (lane_t)carry;
+  for (std::size_t i = 0; i < n; ++i) {
+    lane_t x = (lane_t)in[i];
+    out[i] = (_Type)(_Inclusive ? sum + x : sum);
+    sum += x;
+  }
+  return (_Type)sum;
+}
+
+/**
+ * Helper method: returns the sum of [in, in + n) with wrapping additions. Requires simd_add_type<_Type>.
+ */
+template <class _Type> _Type simd_reduce_add(const _Type *in, std::size_t n) {
+  typedef typename std::make_unsigned<_Type>::type lane_t;
+#ifdef CILKSTL_SIMD_X86
+  if (simd_level() != SimdLevel::SCALAR)
+    return (_Type)__simd::avx2_reduce_add((const lane_t *)in, n);
+#endif
+  lane_t sum = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    sum += (lane_t)in[i];
+  return (_Type)sum;
+}
+
+/**
+ * Defines whether the arg-min and arg-max kernels handle `_Type`: float, double or a signed 32 or 64-bit integer
+ */
+template <class _Type> struct simd_extremum_type {
+  static constexpr bool value = __simd::lane_kind<_Type>::value != __simd::LANES_NONE;
+};
+
+/**
+ * Helper method: returns the index of the first largest element of the nonempty range [in, in + n) under operator< if
+ * `_Max` is true, or of the first smallest one otherwise, using the AVX2 kernel when available. Ranges holding a NaN
+ * are searched again with the scalar std algorithm, so the result always matches it. Requires
+ * simd_extremum_type<_Type>.
+ */
+template <bool _Max, class _Type> std::size_t simd_arg_extremum(const _Type *in, std::size_t n) {
+#ifdef CILKSTL_SIMD_X86
+  constexpr int kind = __simd::lane_kind<_Type>::value;
+  typedef typename __simd::Avx2ExtremumOps<kind>::type lane_t;
+  if (simd_level() != SimdLevel::SCALAR && n < ((std::size_t)1 << 31)) {
+    bool unordered;
+    std::size_t best = __simd::avx2_arg_extremum<_Max, kind>((const lane_t *)in, n, unordered);
+    if (!unordered)
+      return best;
+  }
+#endif
+  return (std::size_t)((_Max ? std::max_element(in, in + n) : std::min_element(in, in + n)) - in);
+}
+
+/**
+ * Defines whether the equality counting kernels handle `_Type`: float, double or an integer of 8 to 64 bits other than
+ * bool
+ */
+template <class _Type> struct simd_count_type {
+  static constexpr bool value = __simd::equal_lane_kind<_Type>::value != __simd::LANES_NONE;
+};
+
+/**
+ * Helper method: returns the number of elements of [in, in + n) equal to `value`, using the AVX2 kernels when
+ * available. Requires simd_count_type<_Type>.
+ */
+template <class _Type> std::size_t simd_count_equal(const _Type *in, std::size_t n, _Type value) {
+#ifdef CILKSTL_SIMD_X86
+  constexpr int kind = __simd::equal_lane_kind<_Type>::value;
+  if (simd_level() != SimdLevel::SCALAR) {
+    if (kind == __simd::LANES_I8)
+      return __simd::avx2_count_equal8((const std::uint8_t *)in, n, (std::uint8_t)value);
+    if (kind == __simd::LANES_I16)
+      return __simd::avx2_count_equal16((const std::uint16_t *)in, n, (std::uint16_t)value);
+    // The narrow layouts have returned above; they map to a wide one only so that this instantiates
+    constexpr int wide_kind = kind == __simd::LANES_I8 || kind == __simd::LANES_I16 ? __simd::LANES_I32 : kind;
+    typedef typename __simd::Avx2Ops<wide_kind>::type lane_t;
+    return __simd::avx2_count_equal<wide_kind>((const lane_t *)in, n, (lane_t)value);
+  }
+#endif
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    count += in[i] == value;
+  return count;
+}
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef CILKSTL_SORT_AUTO_H
+#define CILKSTL_SORT_AUTO_H
+
+#include <cilk/cilk.h>
+
+#include "cilk_algorithm.h"
+#include "cilk_counting_sort.h"
+#include "cilk_stable_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace cilkstl {
+namespace __parallel {
+
+constexpr int SORT_AUTO_SAMPLES = 256;            // number of adjacent pairs sampled to estimate input statistics
+constexpr double SORT_AUTO_DUPLICATE_RATIO = 0.5; // sampled duplicate ratio above which counting sort is considered
+
+/**
+ * This file implements a stable sort front end that samples the input and dispatches to the parallel sorting engine
+ * best suited for it.
+ */
+
+/**
+ * Identifies the engine that sort_auto used to sort its input
+ */
+enum class SortEngine { SERIAL, PRESORTED, REVERSED, COUNTING, MERGE };
+
+/**
+ * Returns a printable name for `engine`
+ */
+inline const char *sort_engine_name(SortEngine engine) {
+  switch (engine) {
+  case SortEngine::SERIAL:
+    return "serial";
+  case SortEngine::PRESORTED:
+    return "presorted";
+  case SortEngine::REVERSED:
+    return "reversed";
+  case SortEngine::COUNTING:
+    return "counting";
+  case SortEngine::MERGE:
+    return "merge";
+  }
+  return "unknown";
+}
+
+/**
+ * Statistics estimated by sort_auto from a sample of the input
+ */
+template <class _DiffType> struct SortSampleStats {
+  double ascending_ratio;  // fraction of sampled adjacent pairs in non-descending order
+  double descending_ratio; // fraction of sampled adjacent pairs in strictly descending order
+  double duplicate_ratio;  // fraction of sampled elements equal to the previous one in sorted sample order
+  _DiffType min_index;     // position of the smallest sampled element
+  _DiffType max_index;     // position of the largest sampled element
+};
+
+/**
+ * Helper method that samples SORT_AUTO_SAMPLES adjacent pairs spread across [first, last) in parallel. The pairs give
+ * an estimate of presortedness, and sorting the sampled positions by value gives the duplicate ratio and the sampled
+ * key range. Assumes the range holds more than SORT_AUTO_SAMPLES elements.
+ */
+template <class _RandomAccessIterator, class _CompareFunc>
+SortSampleStats<typename std::iterator_traits<_RandomAccessIterator>::difference_type>
+sample_sort_statistics(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+  diff_t stride = (range_width - 1) / SORT_AUTO_SAMPLES;
+
+  // Picks one position per stride with a deterministic jitter and classifies the pair starting at it
+  std::vector<diff_t> positions(SORT_AUTO_SAMPLES);
+  std::vector<char> ascending(SORT_AUTO_SAMPLES);
+  std::vector<char> descending(SORT_AUTO_SAMPLES);
+  cilk_for(int i = 0; i < SORT_AUTO_SAMPLES; ++i) {
+    diff_t p = i * stride + (diff_t)(((std::uint64_t)i * 2654435761u) % (std::uint64_t)stride);
+    positions[i] = p;
+    ascending[i] = !comp(*(first + p + 1), *(first + p));
+    descending[i] = comp(*(first + p + 1), *(first + p));
+  }
+
+  std::sort(positions.begin(), positions.end(),
+            [&](diff_t lhs, diff_t rhs) { return comp(*(first + lhs), *(first + rhs)); });
+  int duplicates = 0;
+  for (int i = 1; i < SORT_AUTO_SAMPLES; ++i) {
+    if (!comp(*(first + positions[i - 1]), *(first + positions[i])))
+      ++duplicates;
+  }
+
+  SortSampleStats<diff_t> stats;
+  stats.ascending_ratio = (double)std::count(ascending.begin(), ascending.end(), 1) / SORT_AUTO_SAMPLES;
+  stats.descending_ratio = (double)std::count(descending.begin(), descending.end(), 1) / SORT_AUTO_SAMPLES;
+  stats.duplicate_ratio = (double)duplicates / SORT_AUTO_SAMPLES;
+  stats.min_index = positions.front();
+  stats.max_index = positions.back();
+  return stats;
+}
+
+/**
+ * Helper method that reports the engine chosen by sort_auto. Logging to std::clog is enabled by defining
+ * CILKSTL_SORT_AUTO_LOG before including the library.
+ */
+template <class _DiffType> void log_sort_engine(SortEngine engine, _DiffType range_width) {
+#ifdef CILKSTL_SORT_AUTO_LOG
+  std::clog << "cilkstl::sort_auto: " << sort_engine_name(engine) << " engine for " << range_width << " elements"
+            << std::endl;
+#else
+  (void)engine;
+  (void)range_width;
+#endif
+}
+
+/**
+ * Helper method that handles the inputs sort_auto can finish without a full sort. If every sampled pair is in order
+ * (or strictly descending), the whole range is checked and, when the check succeeds, the range is left alone (or
+ * reversed). Returns true and assigns `engine` if the range was handled.
+ */
+template <class _RandomAccessIterator, class _CompareFunc, class _DiffType>
+bool sort_auto_presorted(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp,
+                         const SortSampleStats<_DiffType> &stats, SortEngine &engine) {
+  if (stats.ascending_ratio == 1.0 && cilkstl::__parallel::is_sorted(first, last, comp)) {
+    engine = SortEngine::PRESORTED;
+    return true;
+  }
+  if (stats.descending_ratio == 1.0 && __sort::is_strictly_descending(first, last, comp)) {
+    cilkstl::__parallel::reverse(first, last);
+    engine = SortEngine::REVERSED;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Stably sorts [first, last) using `comp`, choosing the sorting engine from statistics estimated on a small parallel
+ * sample of the input. Returns the engine that was used.
+ */
+template <class _RandomAccessIterator, class _CompareFunc>
+SortEngine sort_auto(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  diff_t range_width = last - first;
+
+  SortEngine engine = SortEngine::MERGE;
+  if (range_width < __sort::CILKSTL_PARALLEL_CUTOFF) {
+    std::stable_sort(first, last, comp);
+    engine = SortEngine::SERIAL;
+  } else if (!sort_auto_presorted(first, last, comp, sample_sort_statistics(first, last, comp), engine)) {
+    __sort::buffered_merge_sort(first, last, comp);
+  }
+
+  log_sort_engine(engine, range_width);
+  return engine;
+}
+
+/**
+ * Helper method for sort_auto on integral types. Besides the presorted cases, counting sort is considered when the
+ * sampled key range is small relative to the length of the range or the sample holds many duplicates, and is used if
+ * an exact parallel min/max pass confirms that the key range is small.
+ */
+template <class _RandomAccessIterator>
+SortEngine __sort_auto(_RandomAccessIterator first, _RandomAccessIterator last, std::true_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  std::less<value_t> comp;
+  diff_t range_width = last - first;
+
+  SortSampleStats<diff_t> stats = sample_sort_statistics(first, last, comp);
+  SortEngine engine = SortEngine::MERGE;
+  if (sort_auto_presorted(first, last, comp, stats, engine)) {
+    log_sort_engine(engine, range_width);
+    return engine;
+  }
+
+  value_t sampled_min = *(first + stats.min_index);
+  value_t sampled_max = *(first + stats.max_index);
+  std::uintmax_t sampled_span = (std::uintmax_t)sampled_max - (std::uintmax_t)sampled_min;
+  if (__sort::counting_sort_applies(sampled_span, range_width) || stats.duplicate_ratio >= SORT_AUTO_DUPLICATE_RATIO) {
+    auto identity = [](const value_t &v) { return v; };
+    std::pair<value_t, value_t> bounds = __sort::key_minmax(first, last, identity);
+    std::uintmax_t key_span = (std::uintmax_t)bounds.second - (std::uintmax_t)bounds.first;
+    if (__sort::counting_sort_applies(key_span, range_width)) {
+      __sort::counting_sort(first, last, identity, bounds.first, (std::size_t)key_span + 1);
+      engine = SortEngine::COUNTING;
+    }
+  }
+
+  if (engine == SortEngine::MERGE)
+    __sort::buffered_merge_sort(first, last, comp);
+  log_sort_engine(engine, range_width);
+  return engine;
+}
+
+/**
+ * Helper method for sort_auto on non-integral types, which only distinguishes presorted inputs from the general case
+ * as in the comparator overload.
+ */
+template <class _RandomAccessIterator>
+SortEngine __sort_auto(_RandomAccessIterator first, _RandomAccessIterator last, std::false_type) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  return sort_auto(first, last, std::less<value_t>());
+}
+
+/**
+ * Stably sorts [first, last) in ascending order, choosing the sorting engine from statistics estimated on a small
+ * parallel sample of the input. Integral types are additionally considered for counting sort. Returns the engine that
+ * was used.
+ */
+template <class _RandomAccessIterator> SortEngine sort_auto(_RandomAccessIterator first, _RandomAccessIterator last) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+
+  if (range_width < __sort::CILKSTL_PARALLEL_CUTOFF)
+    return sort_auto(first, last, std::less<value_t>());
+  return __sort_auto(first, last, std::is_integral<value_t>());
+}
+
+} // namespace __parallel
+}; // namespace cilkstl
+
+#endif
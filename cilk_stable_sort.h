@@ -2,8 +2,9 @@
 #define CILKSTL_STABLE_SORT_H
 
 #include <cilk/cilk.h>
-#include <cilk/reducer.h>
-#include <cilk/reducer_opadd.h>
+
+#include "cilk_algorithm.h"
+#include "cilk_memory.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -23,21 +24,10 @@ constexpr int CILKSTL_PARALLEL_MERGE_CUTOFF =
  */
 
 /**
- * Defines a buffer datatype for the implementation below
+ * Defines a buffer datatype for the implementation below. Its pages are placed according to the buffer placement
+ * policy in cilk_memory.h.
  */
-template <class _DataType> class StableSortBuffer {
-public:
-  StableSortBuffer(size_t size) { data_ = new _DataType[size]; }
-  ~StableSortBuffer() { delete[] data_; }
-  _DataType *data() { return data_; }
-
-private:
-  _DataType *data_;
-
-  // disallow copies
-  StableSortBuffer(const StableSortBuffer &);
-  StableSortBuffer &operator=(const StableSortBuffer &);
-};
+template <class _DataType> using StableSortBuffer = TemporaryBuffer<_DataType>;
 
 /**
  * Helper method that merges region [as, ae) and [bs, be) using the comparison operator `comp`, and stores the result in
@@ -168,13 +158,42 @@ bool merge_sort(_RandomAccessIterator1 first, _RandomAccessIterator1 last, _Rand
   }
 }
 
+/**
+ * Helper method that stably sorts [first, last) with the parallel merge sort routine above, using a temporary buffer of
+ * equal size to the input sequence.
+ */
+template <class _RandomAccessIterator, class _CompareFunc>
+void buffered_merge_sort(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
+  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
+  diff_t range_width = last - first;
+
+  StableSortBuffer<value_t> buffer(range_width);
+
+  // Computes the stable sort by calling the parallel merge sort routine above. If the result is stored in the temporary
+  // buffer, move it back into the original before returning
+  bool result = merge_sort(first, last, buffer.data(), comp);
+  if (result)
+    move_contents(buffer.data(), buffer.data() + range_width, first);
+}
+
+/**
+ * Helper method that returns true if every element in [first, last) compares strictly less than its predecessor under
+ * `comp`. This reuses the parallel is_sorted recursion with a comparator that flags a violation whenever an element is
+ * not strictly less than the one before it.
+ */
+template <class _RandomAccessIterator, class _CompareFunc>
+bool is_strictly_descending(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp) {
+  typedef typename std::iterator_traits<_RandomAccessIterator>::reference ref_t;
+  return cilkstl::__parallel::is_sorted(first, last, [&](ref_t next, ref_t prev) { return !comp(next, prev); });
+}
+
 /**
  * Implents a parallel version of the spec in std::stable_sort assuming random access.
  */
 template <class _RandomAccessIterator, class _CompareFunc>
 void stable_sort(_RandomAccessIterator first, _RandomAccessIterator last, _CompareFunc comp) {
   typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type diff_t;
-  typedef typename std::iterator_traits<_RandomAccessIterator>::value_type value_t;
   diff_t range_width = last - first;
 
   // Defaults to serial implementation at small range sizes
@@ -183,13 +202,18 @@ void stable_sort(_RandomAccessIterator first, _RandomAccessIterator last, _Compa
     return;
   }
 
-  StableSortBuffer<value_t> buffer(range_width);
+  // Short-circuits inputs that are already sorted or strictly descending. Comparing the endpoints decides which of the
+  // two checks can succeed, and either check cancels at its first violation so random inputs pay very little for it.
+  // Only strictly descending ranges are reversed since reversing equal elements would break stability.
+  if (!comp(*(last - 1), *first)) {
+    if (cilkstl::__parallel::is_sorted(first, last, comp))
+      return;
+  } else if (is_strictly_descending(first, last, comp)) {
+    cilkstl::__parallel::reverse(first, last);
+    return;
+  }
 
-  // Computes the stable sort by calling the parallel merge sort routine above. If the result is stored in the temporary
-  // buffer, move it back into the original before returning
-  bool result = merge_sort(first, last, buffer.data(), comp);
-  if (result)
-    move_contents(buffer.data(), buffer.data() + range_width, first);
+  buffered_merge_sort(first, last, comp);
 }
 
 } // namespace __sort
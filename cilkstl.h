@@ -1,6 +1,14 @@
 #ifndef __CILKSTL_H
 #define __CILKSTL_H
 #include "cilk_algorithm.h"
+#include "cilk_bitmap.h"
+#include "cilk_counting_sort.h"
+#include "cilk_memory.h"
 #include "cilk_partition.h"
+#include "cilk_reduce.h"
+#include "cilk_reducer.h"
+#include "cilk_scan.h"
+#include "cilk_simd.h"
+#include "cilk_sort_auto.h"
 #include "cilk_stable_sort.h"
 #endif
@@ -0,0 +1,336 @@
+#include "../cilkstl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// The deprecated reducer library, timed against cilk_reducer views where the toolchain still ships it
+#if __has_include(<cilk/reducer_max.h>) && __has_include(<cilk/reducer_opadd.h>)
+#include <cilk/reducer_max.h>
+#include <cilk/reducer_opadd.h>
+#define CILKSTL_BENCH_LEGACY_REDUCERS
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Counts data TLB load misses across every thread of the process with perf_event_open. Counters are opened per thread
+ * when measurement starts, so the cilk workers must already exist (a warm-up run takes care of that). Reports -1 when
+ * the counters are unavailable, such as on non-Linux systems or when perf_event_paranoid forbids them.
+ */
+class TlbMissCounter {
+public:
+  void start() {
+    fds_.clear();
+#ifdef __linux__
+    DIR *tasks = opendir("/proc/self/task");
+    if (tasks == nullptr)
+      return;
+    for (dirent *entry = readdir(tasks); entry != nullptr; entry = readdir(tasks)) {
+      if (entry->d_name[0] == '.')
+        continue;
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      int fd = (int)syscall(__NR_perf_event_open, &attr, atoi(entry->d_name), -1, -1, 0);
+      if (fd >= 0)
+        fds_.push_back(fd);
+    }
+    closedir(tasks);
+    for (int fd : fds_)
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  long long stop() {
+    if (fds_.empty())
+      return -1;
+    long long total = 0;
+#ifdef __linux__
+    for (int fd : fds_) {
+      long long value = 0;
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &value, sizeof(value)) == sizeof(value))
+        total += value;
+      close(fd);
+    }
+#endif
+    fds_.clear();
+    return total;
+  }
+
+private:
+  std::vector<int> fds_;
+};
+
+struct BenchOptions {
+  std::string bench = "all";
+  bool huge_pages = true;
+  std::size_t size = 20000000;
+  int repeats = 5;
+};
+
+static std::vector<double> random_vector(size_t size) {
+  static std::default_random_engine engine;
+  static std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+  std::vector<double> result(size);
+  for (size_t i = 0; i < size; ++i)
+    result[i] = distribution(engine);
+
+  return result;
+}
+
+/**
+ * Runs `setup` followed by a timed `run` `repeats` times after one untimed warm-up, and prints the mean time,
+ * throughput and data TLB misses per run.
+ */
+static void run_bench(const char *name, const BenchOptions &options, std::function<void()> setup,
+                      std::function<void()> run) {
+  TlbMissCounter counter;
+  setup();
+  run();
+
+  double seconds = 0;
+  long long tlb_misses = 0;
+  for (int r = 0; r < options.repeats; ++r) {
+    setup();
+    counter.start();
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    long long misses = counter.stop();
+    seconds += std::chrono::duration<double>(end - start).count();
+    tlb_misses = (misses < 0 || tlb_misses < 0) ? -1 : tlb_misses + misses;
+  }
+
+  seconds /= options.repeats;
+  std::cout << name << " huge_pages=" << (options.huge_pages ? "on" : "off") << " n=" << options.size
+            << " time=" << seconds << "s throughput=" << options.size / seconds / 1e6 << "M/s dtlb_misses=";
+  if (tlb_misses < 0)
+    std::cout << "n/a" << std::endl;
+  else
+    std::cout << tlb_misses / options.repeats << std::endl;
+}
+
+// BENCHMARKS
+
+static void bench_stable_sort(const BenchOptions &options) {
+  std::vector<double> input = random_vector(options.size);
+  std::vector<double> v;
+  run_bench("stable_sort", options, [&]() { v = input; },
+            [&]() { cilkstl::__parallel::__sort::stable_sort(v.begin(), v.end(), std::less<double>()); });
+}
+
+static void bench_rotate(const BenchOptions &options) {
+  std::vector<double> v = random_vector(options.size);
+  run_bench("rotate", options, []() {},
+            [&]() { cilkstl::__parallel::rotate(v.begin(), v.begin() + v.size() / 3, v.end()); });
+}
+
+/**
+ * Times every partition implementation on random, skewed and already partitioned inputs
+ */
+static void bench_partition(const BenchOptions &options) {
+  std::vector<double> random = random_vector(options.size);
+  std::vector<double> sorted = random;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::pair<const char *, double>> thresholds = {{"random", 0.5}, {"skewed", 0.05}};
+  std::vector<double> v;
+
+  typedef std::vector<double>::iterator iter_t;
+  std::vector<std::pair<const char *, std::function<iter_t(iter_t, iter_t, double)>>> partitions = {
+      {"partition", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::partition(f, l, [t](double x) { return x < t; });
+       }},
+      {"stable_partition", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::stable_partition(f, l, [t](double x) { return x < t; });
+       }},
+      {"partition_strided", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::partition_strided(f, l, [t](double x) { return x < t; });
+       }},
+      {"partition_buffered", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::partition_buffered(f, l, [t](double x) { return x < t; });
+       }},
+      {"partition_blocked", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::partition_blocked(f, l, [t](double x) { return x < t; });
+       }},
+      {"stable_partition_simd", [](iter_t f, iter_t l, double t) {
+         return cilkstl::__parallel::stable_partition(f, l, cilkstl::__parallel::less_than(t));
+       }}};
+
+  for (auto &partition : partitions) {
+    for (auto &threshold : thresholds) {
+      std::string name = std::string(partition.first) + "/" + threshold.first;
+      run_bench(name.c_str(), options, [&]() { v = random; },
+                [&]() { partition.second(v.begin(), v.end(), threshold.second); });
+    }
+    std::string name = std::string(partition.first) + "/sorted";
+    run_bench(name.c_str(), options, [&]() { v = sorted; }, [&]() { partition.second(v.begin(), v.end(), 0.5); });
+  }
+}
+
+/**
+ * Times an in-place int64 inclusive sum scan next to a memcpy of the same size, which bounds its bandwidth
+ */
+static void bench_scan(const BenchOptions &options) {
+  std::vector<std::int64_t> input(options.size);
+  for (std::size_t i = 0; i < options.size; ++i)
+    input[i] = (std::int64_t)(i % 1000);
+  std::vector<std::int64_t> v(options.size);
+  run_bench("memcpy", options, []() {},
+            [&]() { std::memcpy(v.data(), input.data(), options.size * sizeof(std::int64_t)); });
+  run_bench("inclusive_scan", options, []() {},
+            [&]() { cilkstl::__parallel::inclusive_scan(input.begin(), input.end(), v.begin()); });
+  run_bench("inclusive_scan_single_pass", options, []() {},
+            [&]() { cilkstl::__parallel::inclusive_scan_single_pass(input.begin(), input.end(), v.begin()); });
+  run_bench("inclusive_scan/serial", options, []() {},
+            [&]() { std::partial_sum(input.begin(), input.end(), v.begin()); });
+}
+
+/**
+ * Times the block reductions on ints and doubles next to their serial std counterparts
+ */
+static void bench_reduce(const BenchOptions &options) {
+  std::vector<int> ints(options.size);
+  std::vector<double> doubles(options.size);
+  for (std::size_t i = 0; i < options.size; ++i) {
+    ints[i] = (int)((i * 7919) % 1000);
+    doubles[i] = (double)ints[i] / 1000.0;
+  }
+  volatile long sink = 0;
+  run_bench("count", options, []() {}, [&]() { sink += cilkstl::__parallel::count(ints.begin(), ints.end(), 7); });
+  run_bench("count/serial", options, []() {}, [&]() { sink += std::count(ints.begin(), ints.end(), 7); });
+  std::vector<bool> bits(options.size);
+  bits[options.size - 1] = true;
+  run_bench("count/vector_bool", options, []() {},
+            [&]() { sink += cilkstl::__parallel::count(bits.begin(), bits.end(), true); });
+  run_bench("count/vector_bool/serial", options, []() {},
+            [&]() { sink += std::count(bits.begin(), bits.end(), true); });
+  run_bench("find/vector_bool", options, []() {},
+            [&]() { sink += cilkstl::__parallel::find(bits.begin(), bits.end(), true) - bits.begin(); });
+  run_bench("find/vector_bool/serial", options, []() {},
+            [&]() { sink += std::find(bits.begin(), bits.end(), true) - bits.begin(); });
+  auto odd = [](int x) { return (x & 1) != 0; };
+  std::vector<char> text(options.size);
+  for (std::size_t i = 0; i < options.size; ++i)
+    text[i] = (i * 7919) % 61 == 0 ? '\n' : 'a' + (char)(i % 26);
+  run_bench("count/bytes", options, []() {},
+            [&]() { sink += cilkstl::__parallel::count(text.begin(), text.end(), '\n'); });
+  run_bench("count/bytes/serial", options, []() {}, [&]() { sink += std::count(text.begin(), text.end(), '\n'); });
+  run_bench("count_if", options, []() {},
+            [&]() { sink += cilkstl::__parallel::count_if(ints.begin(), ints.end(), odd); });
+  run_bench("count_if/serial", options, []() {}, [&]() { sink += std::count_if(ints.begin(), ints.end(), odd); });
+  run_bench("reduce", options, []() {},
+            [&]() { sink += cilkstl::__parallel::reduce(ints.begin(), ints.end(), 0L); });
+  run_bench("reduce/serial", options, []() {}, [&]() { sink += std::accumulate(ints.begin(), ints.end(), 0L); });
+  run_bench("max_element", options, []() {},
+            [&]() { sink += cilkstl::__parallel::max_element(doubles.begin(), doubles.end()) - doubles.begin(); });
+  run_bench("max_element/serial", options, []() {},
+            [&]() { sink += std::max_element(doubles.begin(), doubles.end()) - doubles.begin(); });
+  run_bench("minmax_element", options, []() {}, [&]() {
+    sink += cilkstl::__parallel::minmax_element(doubles.begin(), doubles.end()).second - doubles.begin();
+  });
+  run_bench("min_element+max_element", options, []() {}, [&]() {
+    sink += cilkstl::__parallel::min_element(doubles.begin(), doubles.end()) - doubles.begin();
+    sink += cilkstl::__parallel::max_element(doubles.begin(), doubles.end()) - doubles.begin();
+  });
+}
+
+/**
+ * Times one reducer update per element in a cilk_for loop with the legacy reducer library and with cilk_reducer views,
+ * next to the block reduction that updates no hyperobject. Variants the toolchain lacks are skipped.
+ */
+static void bench_reducer(const BenchOptions &options) {
+  std::vector<double> doubles(options.size);
+  for (std::size_t i = 0; i < options.size; ++i)
+    doubles[i] = (double)((i * 7919) % 1000);
+#if defined(CILKSTL_BENCH_LEGACY_REDUCERS) || defined(cilk_reducer)
+  long range_width = (long)options.size;
+#endif
+  volatile double sink = 0;
+#ifdef CILKSTL_BENCH_LEGACY_REDUCERS
+  run_bench("add/legacy_reducer", options, []() {}, [&]() {
+    cilk::reducer<cilk::op_add<double>> sum;
+    cilk_for(long i = 0; i < range_width; ++i) { *sum += doubles[i]; }
+    sink += sum.get_value();
+  });
+  run_bench("max_index/legacy_reducer", options, []() {}, [&]() {
+    cilk::reducer<cilk::op_max_index<long, double>> best;
+    cilk_for(long i = 0; i < range_width; ++i) { best->calc_max(i, doubles[i]); }
+    sink += best.get_value().first;
+  });
+#endif
+#ifdef cilk_reducer
+  run_bench("add/cilk_reducer", options, []() {}, [&]() {
+    cilkstl::__parallel::add_reducer<double> sum = 0;
+    cilk_for(long i = 0; i < range_width; ++i) { sum += doubles[i]; }
+    sink += sum;
+  });
+  run_bench("max_index/cilk_reducer", options, []() {}, [&]() {
+    cilkstl::__parallel::max_index_reducer<long, double> best;
+    cilk_for(long i = 0; i < range_width; ++i) { cilkstl::__parallel::calc_max(best, i, doubles[i]); }
+    sink += best.index;
+  });
+#endif
+  run_bench("add/block_local", options, []() {},
+            [&]() { sink += cilkstl::__parallel::reduce(doubles.begin(), doubles.end(), 0.0); });
+  run_bench("max_index/block_local", options, []() {},
+            [&]() { sink += cilkstl::__parallel::max_element(doubles.begin(), doubles.end()) - doubles.begin(); });
+}
+
+static int usage(const char *program) {
+  std::cerr << "usage: " << program << " [--bench=all|stable_sort|rotate|partition|scan|reduce|reducer]"
+            << " [--huge-pages=on|off] [--size=N] [--repeats=N]" << std::endl;
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--bench=", 0) == 0)
+      options.bench = arg.substr(8);
+    else if (arg == "--huge-pages=on" || arg == "--huge-pages=off")
+      options.huge_pages = (arg == "--huge-pages=on");
+    else if (arg.rfind("--size=", 0) == 0)
+      options.size = std::strtoull(arg.c_str() + 7, nullptr, 10);
+    else if (arg.rfind("--repeats=", 0) == 0)
+      options.repeats = std::max(1, atoi(arg.c_str() + 10));
+    else
+      return usage(argv[0]);
+  }
+
+  cilkstl::__parallel::set_buffer_huge_pages(options.huge_pages);
+  if (options.bench == "all" || options.bench == "stable_sort")
+    bench_stable_sort(options);
+  if (options.bench == "all" || options.bench == "rotate")
+    bench_rotate(options);
+  if (options.bench == "all" || options.bench == "partition")
+    bench_partition(options);
+  if (options.bench == "all" || options.bench == "scan")
+    bench_scan(options);
+  if (options.bench == "all" || options.bench == "reduce")
+    bench_reduce(options);
+  if (options.bench == "all" || options.bench == "reducer")
+    bench_reducer(options);
+  return 0;
+}
@@ -2,8 +2,12 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <string>
 #include <vector>
 
 /**
@@ -238,6 +242,854 @@ int test_stable_sort_correctness2() {
   return 0;
 }
 
+int test_stable_sort_presorted() {
+  std::vector<double> sorted = random_vector(SORT_ARRAY_SIZE);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<double> expected = sorted;
+
+  // already sorted input is left untouched
+  cilkstl::__parallel::__sort::stable_sort(sorted.begin(), sorted.end(), std::less<double>());
+  // strictly descending input is reversed
+  std::vector<double> descending(expected.rbegin(), expected.rend());
+  cilkstl::__parallel::__sort::stable_sort(descending.begin(), descending.end(), std::less<double>());
+  if (sorted != expected || descending != expected) {
+    std::cout << "FAIL: test_stable_sort_presorted" << std::endl;
+    return 1;
+  }
+
+  // descending input with equal keys must not be reversed, or equal elements would change order
+  std::vector<TypedDataSpace> typed = random_typed_vector(SORT_ARRAY_SIZE);
+  std::stable_sort(typed.begin(), typed.end(), [](const TypedDataSpace &lhs, const TypedDataSpace &rhs) {
+    return lhs.type > rhs.type;
+  });
+  std::vector<TypedDataSpace> typed_copy;
+  typed_copy.reserve(SORT_ARRAY_SIZE);
+  for (int j = 0; j < SORT_ARRAY_SIZE; ++j)
+    typed_copy.push_back(std::move(typed[j]));
+  std::stable_sort(typed_copy.begin(), typed_copy.end(), std::less<TypedDataSpace>{});
+  cilkstl::__parallel::__sort::stable_sort(typed.begin(), typed.end(), std::less<TypedDataSpace>{});
+  for (int j = 0; j < SORT_ARRAY_SIZE; ++j) {
+    if (typed[j].id != typed_copy[j].id) {
+      std::cout << "FAIL: test_stable_sort_presorted" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "SUCCESS: test_stable_sort_presorted" << std::endl;
+  return 0;
+}
+
+int test_stable_sort_by_key() {
+  std::vector<TypedDataSpace> random_vectors[SORT_REPEATS];
+  for (int i = 0; i < SORT_REPEATS; ++i)
+    random_vectors[i] = random_typed_vector(SORT_ARRAY_SIZE);
+
+  for (int i = 0; i < SORT_REPEATS; ++i) {
+    std::vector<TypedDataSpace> random_copy;
+    random_copy.reserve(SORT_ARRAY_SIZE);
+    for (int j = 0; j < SORT_ARRAY_SIZE; ++j)
+      random_copy.push_back(std::move(random_vectors[i][j]));
+
+    std::stable_sort(random_copy.begin(), random_copy.end(), std::less<TypedDataSpace>{});
+    cilkstl::__parallel::__sort::stable_sort_by_key(random_vectors[i].begin(), random_vectors[i].end(),
+                                                    [](const TypedDataSpace &v) { return v.type; });
+
+    for (int j = 0; j < random_vectors[i].size(); ++j) {
+      if (random_vectors[i][j].id != random_copy[j].id) {
+        std::cout << "FAIL: test_stable_sort_by_key" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // a key span that covers the whole key type must fall back to stable_sort
+  std::vector<std::int64_t> wide = {std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()};
+  for (std::int64_t j = 0; j < 1000; ++j)
+    wide.push_back(999 - j);
+  std::vector<std::int64_t> wide_copy(wide);
+  std::sort(wide_copy.begin(), wide_copy.end());
+  cilkstl::__parallel::__sort::counting_sort(wide.begin(), wide.end(), [](std::int64_t v) { return v; });
+  if (wide != wide_copy) {
+    std::cout << "FAIL: test_stable_sort_by_key" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_stable_sort_by_key" << std::endl;
+  return 0;
+}
+
+int test_sort_auto() {
+  using cilkstl::__parallel::SortEngine;
+
+  std::vector<double> doubles = random_vector(SORT_ARRAY_SIZE);
+  std::vector<int> small_ints(SORT_ARRAY_SIZE);
+  std::vector<int> wide_ints(SORT_ARRAY_SIZE);
+  for (int j = 0; j < SORT_ARRAY_SIZE; ++j) {
+    small_ints[j] = (int)(doubles[j] * 100);
+    wide_ints[j] = (int)(doubles[j] * 1e9);
+  }
+  std::vector<int> sorted_ints = wide_ints;
+  std::sort(sorted_ints.begin(), sorted_ints.end());
+  std::vector<int> reversed_ints(sorted_ints.rbegin(), sorted_ints.rend());
+
+  std::vector<double> expected_doubles = doubles;
+  std::vector<int> expected_small = small_ints;
+  std::vector<int> expected_wide = wide_ints;
+  std::sort(expected_doubles.begin(), expected_doubles.end());
+  std::sort(expected_small.begin(), expected_small.end());
+  std::sort(expected_wide.begin(), expected_wide.end());
+
+  bool ok = cilkstl::__parallel::sort_auto(doubles.begin(), doubles.end()) == SortEngine::MERGE &&
+            cilkstl::__parallel::sort_auto(small_ints.begin(), small_ints.end()) == SortEngine::COUNTING &&
+            cilkstl::__parallel::sort_auto(wide_ints.begin(), wide_ints.end()) == SortEngine::MERGE &&
+            cilkstl::__parallel::sort_auto(sorted_ints.begin(), sorted_ints.end()) == SortEngine::PRESORTED;
+  // reversed_ints may hold equal neighbours, in which case it must be merge sorted to keep stability
+  cilkstl::__parallel::sort_auto(reversed_ints.begin(), reversed_ints.end());
+
+  if (!ok || doubles != expected_doubles || small_ints != expected_small || wide_ints != expected_wide ||
+      sorted_ints != expected_wide || reversed_ints != expected_wide) {
+    std::cout << "FAIL: test_sort_auto" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_sort_auto" << std::endl;
+  return 0;
+}
+
+constexpr int PARTITION_ARRAY_SIZE = 200000;
+
+/**
+ * Returns the inputs used by the partition tests: random values, values that all satisfy the predicate, values that
+ * all fail it, and values already partitioned by it in either direction.
+ */
+static std::vector<std::vector<double>> partition_inputs() {
+  std::vector<std::vector<double>> inputs;
+  inputs.push_back(random_vector(PARTITION_ARRAY_SIZE));
+  inputs.push_back(std::vector<double>(PARTITION_ARRAY_SIZE, 0.25));
+  inputs.push_back(std::vector<double>(PARTITION_ARRAY_SIZE, 0.75));
+  std::vector<double> sorted = random_vector(PARTITION_ARRAY_SIZE);
+  std::sort(sorted.begin(), sorted.end());
+  inputs.push_back(sorted);
+  inputs.push_back(std::vector<double>(sorted.rbegin(), sorted.rend()));
+  return inputs;
+}
+
+template <class _PartitionFunc> int test_partition_with(const char *name, _PartitionFunc partition, bool stable) {
+  auto pred = [](double x) { return x < 0.5; };
+  for (std::vector<double> &v : partition_inputs()) {
+    std::vector<double> expected = v;
+    auto expected_middle = std::stable_partition(expected.begin(), expected.end(), pred);
+    auto middle = partition(v.begin(), v.end(), pred);
+
+    bool ok = (middle - v.begin()) == (expected_middle - expected.begin()) &&
+              std::is_partitioned(v.begin(), v.end(), pred);
+    if (stable) {
+      ok = ok && v == expected;
+    } else {
+      std::sort(v.begin(), v.end());
+      std::sort(expected.begin(), expected.end());
+      ok = ok && v == expected;
+    }
+    if (!ok) {
+      std::cout << "FAIL: " << name << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "SUCCESS: " << name << std::endl;
+  return 0;
+}
+
+int test_partition() {
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::partition(first, last, pred); };
+  return test_partition_with("test_partition", partition, false);
+}
+
+int test_partition_strided() {
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::partition_strided(first, last, pred); };
+  return test_partition_with("test_partition_strided", partition, false);
+}
+
+int test_partition_buffered() {
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::partition_buffered(first, last, pred); };
+  return test_partition_with("test_partition_buffered", partition, true);
+}
+
+int test_partition_blocked() {
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::partition_blocked(first, last, pred); };
+  return test_partition_with("test_partition_blocked", partition, false);
+}
+
+int test_stable_partition() {
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::stable_partition(first, last, pred); };
+  return test_partition_with("test_stable_partition", partition, true);
+}
+
+int test_partition_copy() {
+  auto pred = [](double x) { return x < 0.5; };
+  for (std::vector<double> &v : partition_inputs()) {
+    std::vector<double> base_true(v.size()), base_false(v.size());
+    std::vector<double> cilkstl_true(v.size()), cilkstl_false(v.size());
+    auto base_result = std::partition_copy(v.begin(), v.end(), base_true.begin(), base_false.begin(), pred);
+    auto cilkstl_result =
+        cilkstl::__parallel::partition_copy(v.begin(), v.end(), cilkstl_true.begin(), cilkstl_false.begin(), pred);
+    if (base_result.first - base_true.begin() != cilkstl_result.first - cilkstl_true.begin() ||
+        base_result.second - base_false.begin() != cilkstl_result.second - cilkstl_false.begin() ||
+        base_true != cilkstl_true || base_false != cilkstl_false) {
+      std::cout << "FAIL: test_partition_copy" << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "SUCCESS: test_partition_copy" << std::endl;
+  return 0;
+}
+
+int test_partition_by() {
+  constexpr int BUCKETS = 7;
+  auto classifier = [](double x) { return (int)(x * BUCKETS); };
+  for (std::vector<double> &v : partition_inputs()) {
+    std::vector<double> expected = v;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](double lhs, double rhs) { return classifier(lhs) < classifier(rhs); });
+    std::vector<std::ptrdiff_t> bounds = cilkstl::__parallel::partition_by(v.begin(), v.end(), classifier, BUCKETS);
+
+    bool ok = v == expected && bounds.front() == 0 && bounds.back() == (std::ptrdiff_t)v.size();
+    for (int c = 0; c < BUCKETS && ok; ++c) {
+      for (std::ptrdiff_t k = bounds[c]; k < bounds[c + 1] && ok; ++k)
+        ok = classifier(v[k]) == c;
+    }
+
+    double pivot = v[v.size() / 3];
+    auto equal = cilkstl::__parallel::partition_three_way(v.begin(), v.end(), pivot);
+    ok = ok && std::all_of(v.begin(), equal.first, [&](double x) { return x < pivot; }) &&
+         std::all_of(equal.first, equal.second, [&](double x) { return x == pivot; }) &&
+         std::all_of(equal.second, v.end(), [&](double x) { return x > pivot; }) && equal.first != equal.second;
+    if (!ok) {
+      std::cout << "FAIL: test_partition_by" << std::endl;
+      return 1;
+    }
+  }
+
+  // a non-positive bucket count leaves the range unchanged
+  std::vector<double> v = random_vector(10), unchanged = v;
+  if (cilkstl::__parallel::partition_by(v.begin(), v.end(), classifier, 0) != std::vector<std::ptrdiff_t>(1, 0) ||
+      v != unchanged) {
+    std::cout << "FAIL: test_partition_by" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_partition_by" << std::endl;
+  return 0;
+}
+
+int test_branchless_partition() {
+  // partition prefixes of every length around the block size to cover the cleanup of partial blocks
+  auto pred = [](double x) { return x < 0.5; };
+  for (std::vector<double> &v : partition_inputs()) {
+    for (std::ptrdiff_t n = 0; n < 1000 && n < (std::ptrdiff_t)v.size(); n += 7) {
+      auto middle = cilkstl::__parallel::branchless_partition(v.begin(), v.begin() + n, pred);
+      if (!std::is_partitioned(v.begin(), v.begin() + n, pred) ||
+          std::find_if_not(v.begin(), v.begin() + n, pred) != middle) {
+        std::cout << "FAIL: test_branchless_partition" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  auto partition = [](std::vector<double>::iterator first, std::vector<double>::iterator last,
+                      bool (*pred)(double)) { return cilkstl::__parallel::branchless_partition(first, last, pred); };
+  return test_partition_with("test_branchless_partition", partition, false);
+}
+
+/**
+ * Checks stable_partition and partition_copy with a threshold predicate, which run on the SIMD kernels, against the
+ * standard library on values of `_Type` in [0, 1000)
+ */
+template <class _Type, class _PredicateFunc> bool check_simd_partition(_PredicateFunc pred) {
+  std::vector<_Type> v(PARTITION_ARRAY_SIZE + 13);
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = (_Type)((i * 7919) % 1000);
+  std::vector<_Type> expected = v;
+  auto expected_middle = std::stable_partition(expected.begin(), expected.end(), pred);
+  std::vector<_Type> copy_true(v.size()), copy_false(v.size());
+  auto copy_result =
+      cilkstl::__parallel::partition_copy(v.begin(), v.end(), copy_true.begin(), copy_false.begin(), pred);
+  auto middle = cilkstl::__parallel::stable_partition(v.begin(), v.end(), pred);
+
+  size_t num_true = expected_middle - expected.begin();
+  return v == expected && (size_t)(middle - v.begin()) == num_true &&
+         std::equal(expected.begin(), expected_middle, copy_true.begin(), copy_result.first) &&
+         std::equal(expected_middle, expected.end(), copy_false.begin(), copy_result.second);
+}
+
+template <class _Type> bool check_simd_partition_type() {
+  using namespace cilkstl::__parallel;
+  return check_simd_partition<_Type>(less_than<_Type>(500)) && check_simd_partition<_Type>(greater_than<_Type>(900)) &&
+         check_simd_partition<_Type>(less_or_equal<_Type>(0)) &&
+         check_simd_partition<_Type>(greater_or_equal<_Type>(-1));
+}
+
+int test_simd_partition() {
+  using cilkstl::__parallel::SimdLevel;
+  bool ok = true;
+  for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+    cilkstl::__parallel::set_simd_level(level);
+    ok = ok && check_simd_partition_type<int>() && check_simd_partition_type<long long>() &&
+         check_simd_partition_type<float>() && check_simd_partition_type<double>();
+  }
+  cilkstl::__parallel::set_simd_level(cilkstl::__parallel::detected_simd_level());
+
+  if (!ok) {
+    std::cout << "FAIL: test_simd_partition" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_simd_partition" << std::endl;
+  return 0;
+}
+
+/**
+ * Checks copy_if, copy_if_single_pass and remove_copy_if against the standard library for predicate `pred`
+ */
+template <class _Type, class _PredicateFunc> bool check_copy_if(const std::vector<_Type> &v, _PredicateFunc pred) {
+  std::vector<_Type> expected, expected_removed;
+  std::copy_if(v.begin(), v.end(), std::back_inserter(expected), pred);
+  std::remove_copy_if(v.begin(), v.end(), std::back_inserter(expected_removed), pred);
+
+  std::vector<_Type> copied(v.size()), single_pass(v.size()), removed(v.size());
+  copied.resize(cilkstl::__parallel::copy_if(v.begin(), v.end(), copied.begin(), pred) - copied.begin());
+  single_pass.resize(cilkstl::__parallel::copy_if_single_pass(v.begin(), v.end(), single_pass.begin(), pred) -
+                     single_pass.begin());
+  removed.resize(cilkstl::__parallel::remove_copy_if(v.begin(), v.end(), removed.begin(), pred) - removed.begin());
+  return copied == expected && single_pass == expected && removed == expected_removed;
+}
+
+int test_copy_if() {
+  bool ok = true;
+  for (std::vector<double> &v : partition_inputs()) {
+    ok = ok && check_copy_if(v, [](double x) { return x < 0.5; }) &&
+         check_copy_if(v, cilkstl::__parallel::less_than(0.5));
+  }
+  std::vector<int> ints(PARTITION_ARRAY_SIZE);
+  for (size_t i = 0; i < ints.size(); ++i)
+    ints[i] = (int)((i * 7919) % 1000);
+  ok = ok && check_copy_if(ints, cilkstl::__parallel::greater_or_equal(100)) &&
+       check_copy_if(ints, [](int x) { return x % 3 == 0; });
+
+  if (!ok) {
+    std::cout << "FAIL: test_copy_if" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_copy_if" << std::endl;
+  return 0;
+}
+
+int test_remove_if() {
+  bool ok = true;
+  for (std::vector<double> &v : partition_inputs()) {
+    std::vector<double> expected = v, lambda = v, threshold = v;
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [](double x) { return x < 0.5; }), expected.end());
+    lambda.erase(cilkstl::__parallel::remove_if(lambda.begin(), lambda.end(), [](double x) { return x < 0.5; }),
+                 lambda.end());
+    threshold.erase(
+        cilkstl::__parallel::remove_if(threshold.begin(), threshold.end(), cilkstl::__parallel::less_than(0.5)),
+        threshold.end());
+    ok = ok && lambda == expected && threshold == expected;
+  }
+
+  // Kept elements must be moved rather than copied, which preserves their ids
+  std::vector<TypedDataSpace> data = random_typed_vector(PARTITION_ARRAY_SIZE);
+  std::vector<std::int64_t> expected_ids;
+  for (const TypedDataSpace &d : data) {
+    if (d.type != 3)
+      expected_ids.push_back(d.id);
+  }
+  auto is_three = [](const TypedDataSpace &d) { return d.type == 3; };
+  auto end = cilkstl::__parallel::remove_if(data.begin(), data.end(), is_three);
+  ok = ok && end - data.begin() == (std::ptrdiff_t)expected_ids.size();
+  for (size_t i = 0; ok && i < expected_ids.size(); ++i)
+    ok = data[i].id == expected_ids[i];
+
+  std::vector<int> ints(PARTITION_ARRAY_SIZE);
+  for (size_t i = 0; i < ints.size(); ++i)
+    ints[i] = (int)(i % 5);
+  std::vector<int> expected_ints = ints;
+  expected_ints.erase(std::remove(expected_ints.begin(), expected_ints.end(), 3), expected_ints.end());
+  ints.erase(cilkstl::__parallel::remove(ints.begin(), ints.end(), 3), ints.end());
+  ok = ok && ints == expected_ints;
+
+  if (!ok) {
+    std::cout << "FAIL: test_remove_if" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_remove_if" << std::endl;
+  return 0;
+}
+
+/**
+ * Checks a selection bitmap built by select_bitmap with `pred`, and the algorithms driven by it, against the standard
+ * library
+ */
+template <class _Type, class _PredicateFunc> bool check_selection_bitmap(std::vector<_Type> v, _PredicateFunc pred) {
+  cilkstl::__parallel::SelectionBitmap selection = cilkstl::__parallel::select_bitmap(v.begin(), v.end(), pred);
+  std::vector<std::size_t> expected_positions;
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (pred(v[i]))
+      expected_positions.push_back(i);
+  }
+  bool ok = selection.positions() == expected_positions &&
+            cilkstl::__parallel::count_if(v.begin(), v.end(), selection) == (std::ptrdiff_t)expected_positions.size();
+  for (std::size_t k = 0; ok && k < expected_positions.size(); k += 997) {
+    ok = selection.select(k) == expected_positions[k] && selection.rank(expected_positions[k]) == k &&
+         selection.rank(expected_positions[k] + 1) == k + 1;
+  }
+  ok = ok && selection.rank(v.size()) == expected_positions.size();
+
+  std::vector<_Type> expected = v;
+  std::stable_partition(expected.begin(), expected.end(), pred);
+  std::vector<_Type> copied(v.size()), copy_true(v.size()), copy_false(v.size());
+  auto copy_end = cilkstl::__parallel::copy_if(v.begin(), v.end(), copied.begin(), selection);
+  auto copy_result =
+      cilkstl::__parallel::partition_copy(v.begin(), v.end(), copy_true.begin(), copy_false.begin(), selection);
+  auto middle = cilkstl::__parallel::stable_partition(v.begin(), v.end(), selection);
+  std::size_t num_true = expected_positions.size();
+  return ok && v == expected && (std::size_t)(middle - v.begin()) == num_true &&
+         std::equal(expected.begin(), expected.begin() + num_true, copied.begin(), copy_end) &&
+         std::equal(expected.begin(), expected.begin() + num_true, copy_true.begin(), copy_result.first) &&
+         std::equal(expected.begin() + num_true, expected.end(), copy_false.begin(), copy_result.second);
+}
+
+int test_selection_bitmap() {
+  bool ok = true;
+  for (std::vector<double> &v : partition_inputs()) {
+    ok = ok && check_selection_bitmap(v, [](double x) { return x < 0.5; }) &&
+         check_selection_bitmap(v, cilkstl::__parallel::less_than(0.5));
+  }
+  std::vector<int> ints(PARTITION_ARRAY_SIZE + 37);
+  for (size_t i = 0; i < ints.size(); ++i)
+    ints[i] = (int)((i * 7919) % 1000);
+  ok = ok && check_selection_bitmap(ints, cilkstl::__parallel::greater_than(990)) &&
+       check_selection_bitmap(std::vector<int>(100, 1), [](int x) { return x == 1; });
+
+  if (!ok) {
+    std::cout << "FAIL: test_selection_bitmap" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_selection_bitmap" << std::endl;
+  return 0;
+}
+
+int test_is_partitioned() {
+  auto pred = [](double x) { return x < 0.5; };
+  bool ok = true;
+  for (std::vector<double> &v : partition_inputs()) {
+    ok = ok && cilkstl::__parallel::is_partitioned(v.begin(), v.end(), pred) ==
+                   std::is_partitioned(v.begin(), v.end(), pred);
+    std::stable_partition(v.begin(), v.end(), pred);
+    ok = ok && cilkstl::__parallel::is_partitioned(v.begin(), v.end(), pred) &&
+         cilkstl::__parallel::partition_point(v.begin(), v.end(), pred) ==
+             std::partition_point(v.begin(), v.end(), pred);
+
+    // A single violation at the boundary of the two halves or deep inside a leaf must be found
+    if (v.size() > 1 && pred(v.front()) != pred(v.back())) {
+      auto point = std::partition_point(v.begin(), v.end(), pred);
+      std::iter_swap(point - 1, point);
+      ok = ok && !cilkstl::__parallel::is_partitioned(v.begin(), v.end(), pred);
+      std::iter_swap(point - 1, point);
+    }
+  }
+
+  std::vector<double> sorted = random_vector(PARTITION_ARRAY_SIZE);
+  std::sort(sorted.begin(), sorted.end());
+  std::swap(sorted[PARTITION_ARRAY_SIZE / 2 - 1], sorted[PARTITION_ARRAY_SIZE / 2]);
+  ok = ok && !cilkstl::__parallel::is_partitioned(sorted.begin(), sorted.end(),
+                                                  [&](double x) { return x < sorted[PARTITION_ARRAY_SIZE / 2 - 1]; });
+  std::sort(sorted.begin(), sorted.end());
+
+  typedef std::function<bool(double)> pred_t;
+  std::vector<pred_t> queries;
+  for (int q = 0; q <= 100; ++q)
+    queries.push_back([q](double x) { return x < q / 100.0; });
+  std::vector<std::vector<double>::iterator> points(queries.size());
+  cilkstl::__parallel::batch_partition_point(sorted.begin(), sorted.end(), queries.begin(), queries.end(),
+                                             points.begin());
+  for (size_t q = 0; q < queries.size(); ++q)
+    ok = ok && points[q] == std::lower_bound(sorted.begin(), sorted.end(), q / 100.0);
+
+  if (!ok) {
+    std::cout << "FAIL: test_is_partitioned" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_is_partitioned" << std::endl;
+  return 0;
+}
+
+int test_scan() {
+  using cilkstl::__parallel::SimdLevel;
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)1, (size_t)1000, (size_t)1000003}) {
+    std::vector<std::int64_t> longs(n);
+    std::vector<int> ints(n);
+    for (size_t i = 0; i < n; ++i) {
+      longs[i] = (std::int64_t)((i * 7919) % 1000) - 300;
+      ints[i] = (int)((i * 104729) % 2000) - 1000;
+    }
+
+    std::vector<std::int64_t> expected(n), result(n);
+    std::inclusive_scan(longs.begin(), longs.end(), expected.begin());
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2}) {
+      cilkstl::__parallel::set_simd_level(level);
+      cilkstl::__parallel::inclusive_scan(longs.begin(), longs.end(), result.begin());
+      ok = ok && result == expected;
+      std::vector<int> int_expected(n), int_result = ints;
+      std::exclusive_scan(ints.begin(), ints.end(), int_expected.begin(), 5);
+      cilkstl::__parallel::exclusive_scan_inplace(int_result.begin(), int_result.end(), 5);
+      ok = ok && int_result == int_expected;
+    }
+    cilkstl::__parallel::set_simd_level(cilkstl::__parallel::detected_simd_level());
+
+    // Non-commutative operator: the last element of each prefix, seeded with -1
+    auto last_of = [](std::int64_t, std::int64_t rhs) { return rhs; };
+    std::exclusive_scan(longs.begin(), longs.end(), expected.begin(), (std::int64_t)-1, last_of);
+    cilkstl::__parallel::exclusive_scan(longs.begin(), longs.end(), result.begin(), (std::int64_t)-1, last_of);
+    ok = ok && result == expected;
+
+    std::vector<double> doubles(n), double_expected(n), double_result(n);
+    auto square = [](std::int64_t x) { return (double)(x * x); };
+    auto max_op = [](double lhs, double rhs) { return std::max(lhs, rhs); };
+    std::transform_inclusive_scan(longs.begin(), longs.end(), double_expected.begin(), max_op, square);
+    cilkstl::__parallel::transform_inclusive_scan(longs.begin(), longs.end(), double_result.begin(), max_op, square);
+    ok = ok && double_result == double_expected;
+    std::transform_exclusive_scan(longs.begin(), longs.end(), double_expected.begin(), 0.5, std::plus<>(), square);
+    cilkstl::__parallel::transform_exclusive_scan(longs.begin(), longs.end(), double_result.begin(), 0.5,
+                                                  std::plus<>(), square);
+    ok = ok && double_result == double_expected;
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_scan" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_scan" << std::endl;
+  return 0;
+}
+
+int test_scan_single_pass() {
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)1000, (size_t)16384, (size_t)1000003}) {
+    std::vector<std::int64_t> longs(n), expected(n), result(n);
+    for (size_t i = 0; i < n; ++i)
+      longs[i] = (std::int64_t)((i * 7919) % 1000) - 300;
+
+    std::inclusive_scan(longs.begin(), longs.end(), expected.begin());
+    cilkstl::__parallel::inclusive_scan_single_pass(longs.begin(), longs.end(), result.begin());
+    ok = ok && result == expected;
+
+    // Non-commutative operator, in place: the last element of each prefix, seeded with -1
+    auto last_of = [](std::int64_t, std::int64_t rhs) { return rhs; };
+    std::exclusive_scan(longs.begin(), longs.end(), expected.begin(), (std::int64_t)-1, last_of);
+    result = longs;
+    cilkstl::__parallel::exclusive_scan_single_pass(result.begin(), result.end(), result.begin(), (std::int64_t)-1,
+                                                    last_of);
+    ok = ok && result == expected;
+
+    std::vector<double> doubles(longs.begin(), longs.end()), double_expected(n), double_result(n);
+    auto max_op = [](double lhs, double rhs) { return std::max(lhs, rhs); };
+    std::inclusive_scan(doubles.begin(), doubles.end(), double_expected.begin(), max_op);
+    cilkstl::__parallel::inclusive_scan_single_pass(doubles.begin(), doubles.end(), double_result.begin(), max_op);
+    ok = ok && double_result == double_expected;
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_scan_single_pass" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_scan_single_pass" << std::endl;
+  return 0;
+}
+
+int test_segmented_scan() {
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)1, (size_t)1000, (size_t)200003}) {
+    // Sorted keys with runs of varying length, some spanning many blocks
+    std::vector<int> keys(n), values(n), flags(n), expected(n), result(n);
+    for (size_t i = 0; i < n; ++i) {
+      keys[i] = i < 60000 ? 0 : (int)((i / 37) * (i / 37) / 2000);
+      values[i] = (int)((i * 7919) % 100) - 40;
+      flags[i] = i == 0 || keys[i] != keys[i - 1];
+    }
+
+    std::vector<int> expected_keys, expected_sums;
+    for (size_t i = 0; i < n; ++i) {
+      expected[i] = flags[i] ? values[i] : expected[i - 1] + values[i];
+      if (flags[i]) {
+        expected_keys.push_back(keys[i]);
+        expected_sums.push_back(0);
+      }
+      expected_sums.back() += values[i];
+    }
+
+    cilkstl::__parallel::segmented_inclusive_scan(values.begin(), values.end(), flags.begin(), result.begin());
+    ok = ok && result == expected;
+    result = values;
+    cilkstl::__parallel::segmented_inclusive_scan_by_key(keys.begin(), keys.end(), result.begin(), result.begin());
+    ok = ok && result == expected;
+
+    std::vector<int> keys_out(n), sums_out(n);
+    auto ends = cilkstl::__parallel::reduce_by_key(keys.begin(), keys.end(), values.begin(), keys_out.begin(),
+                                                   sums_out.begin());
+    keys_out.resize(ends.first - keys_out.begin());
+    sums_out.resize(ends.second - sums_out.begin());
+    ok = ok && keys_out == expected_keys && sums_out == expected_sums;
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_segmented_scan" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_segmented_scan" << std::endl;
+  return 0;
+}
+
+int test_adjacent() {
+  bool ok = true;
+
+  // Strictly increasing IDs with one duplicate planted at varying positions, including across leaf boundaries
+  std::vector<int> ids(100000);
+  for (int i = 0; i < (int)ids.size(); ++i)
+    ids[i] = 2 * i;
+  ok = ok && cilkstl::__parallel::adjacent_find(ids.begin(), ids.end()) == ids.end();
+  for (int pos : {0, 2399, 2400, 50000, 99998}) {
+    std::vector<int> v = ids;
+    v[pos + 1] = v[pos];
+    v[99999] = v[99998] + (pos == 99998 ? 0 : 1);
+    ok = ok && cilkstl::__parallel::adjacent_find(v.begin(), v.end()) == std::adjacent_find(v.begin(), v.end());
+  }
+  auto gap = [](int lhs, int rhs) { return rhs - lhs > 2; };
+  std::vector<int> gapped = ids;
+  gapped[70000] += 1;
+  ok = ok && cilkstl::__parallel::adjacent_find(gapped.begin(), gapped.end(), gap) ==
+                 std::adjacent_find(gapped.begin(), gapped.end(), gap);
+
+  // Differences across block boundaries, out of place and in place
+  std::vector<double> tmp_doubles = random_vector(100003);
+  std::vector<long> values, expected(tmp_doubles.size()), result(tmp_doubles.size());
+  for (double d : tmp_doubles)
+    values.push_back((long)(d * 100000));
+  std::adjacent_difference(values.begin(), values.end(), expected.begin());
+  cilkstl::__parallel::adjacent_difference(values.begin(), values.end(), result.begin());
+  ok = ok && result == expected;
+  cilkstl::__parallel::adjacent_difference(values.begin(), values.end(), values.begin());
+  ok = ok && values == expected;
+
+  if (!ok) {
+    std::cout << "FAIL: test_adjacent" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_adjacent" << std::endl;
+  return 0;
+}
+
+int test_reduce() {
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)1, (size_t)8192, (size_t)100003}) {
+    std::vector<int> v(n);
+    for (size_t i = 0; i < n; ++i)
+      v[i] = (int)((i * 7919) % 1000);
+
+    ok = ok && cilkstl::__parallel::reduce(v.begin(), v.end()) == std::accumulate(v.begin(), v.end(), 0);
+    ok = ok && cilkstl::__parallel::reduce(v.begin(), v.end(), (long)5) == std::accumulate(v.begin(), v.end(), (long)5);
+    ok = ok && cilkstl::__parallel::transform_reduce(v.begin(), v.end(), v.begin(), (long)0) ==
+                   std::inner_product(v.begin(), v.end(), v.begin(), (long)0);
+    auto square = [](int x) { return (long)x * x; };
+    ok = ok && cilkstl::__parallel::transform_reduce(v.begin(), v.end(), (long)0, std::plus<>(), square) ==
+                   std::inner_product(v.begin(), v.end(), v.begin(), (long)0);
+
+    // Non-commutative operator: concatenation of decimal digits, kept small by only looking at a prefix
+    std::vector<std::string> digits;
+    for (size_t i = 0; i < std::min(n, (size_t)20000); ++i)
+      digits.push_back(std::to_string(v[i] % 10));
+    ok = ok && cilkstl::__parallel::reduce(digits.begin(), digits.end(), std::string("x")) ==
+                   std::accumulate(digits.begin(), digits.end(), std::string("x"));
+
+    ok = ok && cilkstl::__parallel::count(v.begin(), v.end(), 7) == std::count(v.begin(), v.end(), 7);
+    auto odd = [](int x) { return x % 2 == 1; };
+    ok = ok && cilkstl::__parallel::count_if(v.begin(), v.end(), odd) == std::count_if(v.begin(), v.end(), odd);
+
+    // Many equal extremes: the first minimum and the first maximum, or the last for minmax_element, must be returned
+    ok = ok && cilkstl::__parallel::min_element(v.begin(), v.end()) == std::min_element(v.begin(), v.end());
+    ok = ok && cilkstl::__parallel::max_element(v.begin(), v.end()) == std::max_element(v.begin(), v.end());
+    ok = ok && cilkstl::__parallel::max_element(v.begin(), v.end(), std::greater<>()) ==
+                   std::max_element(v.begin(), v.end(), std::greater<>());
+    ok = ok && cilkstl::__parallel::minmax_element(v.begin(), v.end()) == std::minmax_element(v.begin(), v.end());
+    ok = ok && cilkstl::__parallel::minmax_element(v.begin(), v.end(), std::greater<>()) ==
+                   std::minmax_element(v.begin(), v.end(), std::greater<>());
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_reduce" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_reduce" << std::endl;
+  return 0;
+}
+
+int test_reducer_views() {
+  // Folds chunk views left to right as the runtime would, with repeated extremes so the tie rules matter
+  std::vector<int> v(10007);
+  for (int i = 0; i < (int)v.size(); ++i)
+    v[i] = (i * 7919) % 101;
+
+  bool ok = true;
+  for (int chunk : {1, 7, 1000, 20000}) {
+    cilkstl::__parallel::IndexedValue<long, int> max_total, min_total;
+    for (int start = 0; start < (int)v.size(); start += chunk) {
+      cilkstl::__parallel::IndexedValue<long, int> max_view, min_view;
+      for (int i = start; i < std::min((int)v.size(), start + chunk); ++i) {
+        cilkstl::__parallel::calc_max(max_view, (long)i, v[i]);
+        cilkstl::__parallel::calc_min(min_view, (long)i, v[i]);
+      }
+      cilkstl::__parallel::reducer_max<decltype(max_view), std::less<int>>(&max_total, &max_view);
+      cilkstl::__parallel::reducer_min<decltype(min_view), std::less<int>>(&min_total, &min_view);
+    }
+    ok = ok && max_total.index == std::max_element(v.begin(), v.end()) - v.begin();
+    ok = ok && min_total.index == std::min_element(v.begin(), v.end()) - v.begin();
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_reducer_views" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_reducer_views" << std::endl;
+  return 0;
+}
+
+/**
+ * Checks min_element and max_element on `_Type` against the standard library, on short ranges, on ranges with many
+ * equal extremes spread over lanes and blocks, and on a range holding a NaN for floating point types
+ */
+template <class _Type> bool check_simd_extremum_type() {
+  bool ok = true;
+  for (size_t n : {(size_t)1, (size_t)5, (size_t)17, (size_t)100003}) {
+    std::vector<_Type> v(n);
+    for (size_t i = 0; i < n; ++i)
+      v[i] = (_Type)((long)((i * 7919) % 2003) - 1000);
+    ok = ok && cilkstl::__parallel::min_element(v.begin(), v.end()) == std::min_element(v.begin(), v.end()) &&
+         cilkstl::__parallel::max_element(v.begin(), v.end()) == std::max_element(v.begin(), v.end());
+    if (std::is_floating_point<_Type>::value && n > 1) {
+      v[n / 2] = std::numeric_limits<_Type>::quiet_NaN();
+      ok = ok && cilkstl::__parallel::min_element(v.begin(), v.end()) == std::min_element(v.begin(), v.end()) &&
+           cilkstl::__parallel::max_element(v.begin(), v.end()) == std::max_element(v.begin(), v.end());
+    }
+  }
+  return ok;
+}
+
+int test_simd_extremum() {
+  using cilkstl::__parallel::SimdLevel;
+  bool ok = true;
+  for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2}) {
+    cilkstl::__parallel::set_simd_level(level);
+    ok = ok && check_simd_extremum_type<int>() && check_simd_extremum_type<long long>() &&
+         check_simd_extremum_type<float>() && check_simd_extremum_type<double>();
+  }
+  cilkstl::__parallel::set_simd_level(cilkstl::__parallel::detected_simd_level());
+
+  if (!ok) {
+    std::cout << "FAIL: test_simd_extremum" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_simd_extremum" << std::endl;
+  return 0;
+}
+
+/**
+ * Checks count with `value` and count_if with a threshold predicate on `_Type` against the standard library, with more
+ * than 255 matches per byte lane counter so that the counters must be flushed
+ */
+template <class _Type, class _Value> bool check_simd_count_type(_Value value) {
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)31, (size_t)100, (size_t)300007}) {
+    std::vector<_Type> v(n);
+    for (size_t i = 0; i < n; ++i)
+      v[i] = (_Type)(i % 3 == 0 ? (long)value : (long)((i * 7919) % 97));
+    ok = ok && cilkstl::__parallel::count(v.begin(), v.end(), value) == std::count(v.begin(), v.end(), value);
+    auto below = cilkstl::__parallel::less_than((_Type)50);
+    ok = ok && cilkstl::__parallel::count_if(v.begin(), v.end(), below) == std::count_if(v.begin(), v.end(), below);
+  }
+  return ok;
+}
+
+int test_simd_count() {
+  using cilkstl::__parallel::SimdLevel;
+  bool ok = true;
+  for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2}) {
+    cilkstl::__parallel::set_simd_level(level);
+    ok = ok && check_simd_count_type<char>('\n') && check_simd_count_type<std::uint8_t>(200) &&
+         check_simd_count_type<std::int8_t>(-3) && check_simd_count_type<std::uint16_t>(60000) &&
+         check_simd_count_type<short>(-7) && check_simd_count_type<int>(7) &&
+         check_simd_count_type<unsigned>(7u) && check_simd_count_type<long>(-5L) &&
+         check_simd_count_type<float>(2.0f) && check_simd_count_type<double>(-0.0);
+
+    // Values that do not fit the element type match nothing
+    std::vector<std::uint8_t> bytes(100000, 44);
+    ok = ok && cilkstl::__parallel::count(bytes.begin(), bytes.end(), 300) == 0 &&
+         cilkstl::__parallel::count(bytes.begin(), bytes.end(), 44 + 256) == 0 &&
+         cilkstl::__parallel::count(bytes.begin(), bytes.end(), 44L) == 100000;
+  }
+  cilkstl::__parallel::set_simd_level(cilkstl::__parallel::detected_simd_level());
+
+  if (!ok) {
+    std::cout << "FAIL: test_simd_count" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_simd_count" << std::endl;
+  return 0;
+}
+
+int test_vector_bool() {
+  bool ok = true;
+  for (size_t n : {(size_t)0, (size_t)1, (size_t)64, (size_t)130, (size_t)1000003}) {
+    std::vector<bool> bits(n);
+    for (size_t i = 0; i < n; ++i)
+      bits[i] = (i * 7919) % 13 == 0;
+
+    // Subranges starting and ending inside words, on both iterator types
+    for (size_t skip : {(size_t)0, (size_t)3, (size_t)64}) {
+      if (skip > n)
+        continue;
+      auto first = bits.begin() + skip;
+      std::vector<bool>::const_iterator cfirst = bits.cbegin() + skip, clast = bits.cend() - (n - skip) / 3;
+      for (bool value : {false, true}) {
+        ok = ok && cilkstl::__parallel::count(first, bits.end(), value) == std::count(first, bits.end(), value);
+        ok = ok && cilkstl::__parallel::count(cfirst, clast, value) == std::count(cfirst, clast, value);
+        ok = ok && cilkstl::__parallel::find(first, bits.end(), value) == std::find(first, bits.end(), value);
+        ok = ok && cilkstl::__parallel::find(cfirst, clast, value) == std::find(cfirst, clast, value);
+      }
+      ok = ok && cilkstl::__parallel::count(first, bits.end(), 2) == 0;
+    }
+
+    // A single set bit far from the start, and the same bits seen through a SelectionBitmap
+    std::vector<bool> sparse(n);
+    if (n > 0)
+      sparse[n - 1] = true;
+    ok = ok && cilkstl::__parallel::find(sparse.begin(), sparse.end(), true) ==
+                   std::find(sparse.begin(), sparse.end(), true);
+    std::vector<int> ints(bits.begin(), bits.end());
+    auto selection = cilkstl::__parallel::select_bitmap(ints.begin(), ints.end(), [](int x) { return x != 0; });
+    cilkstl::__parallel::BitsetView view(selection);
+    ok = ok && cilkstl::__parallel::count(view, true) == selection.count() &&
+         cilkstl::__parallel::find(view, true) == (size_t)(std::find(ints.begin(), ints.end(), 1) - ints.begin());
+  }
+
+  if (!ok) {
+    std::cout << "FAIL: test_vector_bool" << std::endl;
+    return 1;
+  }
+  std::cout << "SUCCESS: test_vector_bool" << std::endl;
+  return 0;
+}
+
 int main() {
     test_rotate_element();
     test_min_element();
@@ -245,5 +1097,30 @@ int main() {
     test_find2();
     test_stable_sort_correctness1();
     test_stable_sort_correctness2();
+    test_stable_sort_presorted();
+    test_stable_sort_by_key();
+    test_sort_auto();
+    test_partition();
+    test_partition_strided();
+    test_partition_buffered();
+    test_partition_blocked();
+    test_stable_partition();
+    test_partition_copy();
+    test_partition_by();
+    test_branchless_partition();
+    test_simd_partition();
+    test_copy_if();
+    test_remove_if();
+    test_selection_bitmap();
+    test_is_partitioned();
+    test_scan();
+    test_scan_single_pass();
+    test_segmented_scan();
+    test_adjacent();
+    test_reduce();
+    test_reducer_views();
+    test_simd_extremum();
+    test_simd_count();
+    test_vector_bool();
     return 0;
 }